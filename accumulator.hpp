@@ -0,0 +1,104 @@
+#pragma once
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <optional>
+#include "quaternion.hpp"
+#include "matrix.hpp"
+#include "precision.hpp"
+
+//Composition of long rotation chains: q1*q2*...*qn, kept at unit norm.
+//Each step is one Hamilton product on registers, with no temporaries. The squared norm is checked after
+//every step, and only when it drifts beyond the tolerance is it pulled back with a first-order Newton
+//step for 1/sqrt (q *= (3 - |q|^2)/2), which costs a few multiplies and no sqrt. The step leaves an error of
+//about 3/4 deviation^2, so it is only taken for small drifts; larger ones are scaled by the exact 1/sqrt.
+//Mixed precision: RotationAccumulator<float, double> takes and returns float quaternions, but composes in
+//double, so long chains keep double accuracy while the inputs stay in float storage.
+template<typename T, typename A = T>
+class RotationAccumulator{
+	private:
+	A w = 1, x = 0, y = 0, z = 0;
+	A tolerance; //allowed deviation of |q|^2 from 1
+	std::size_t renormalizations = 0;
+
+	void renormalize() {
+		const A n2 = w*w + x*x + y*y + z*z;
+		const A deviation = n2 - 1;
+		if(std::abs(deviation) <= tolerance){
+			return;
+		}
+		//Newton's step leaves 3/4 deviation^2: below 1e-4 that is under 1e-8, within any tolerance of the
+		//accumulator; beyond that (sloppy or bad input) use the exact scale
+		const A scale = std::abs(deviation) < A(1e-4) ? (3 - n2) / 2 : 1 / std::sqrt(n2);
+		w *= scale;
+		x *= scale;
+		y *= scale;
+		z *= scale;
+		++renormalizations;
+	}
+
+	void multiply(A bw, A bx, A by, A bz) {
+		const A tw = w*bw - x*bx - y*by - z*bz;
+		const A tx = w*bx + x*bw + y*bz - z*by;
+		const A ty = w*by - x*bz + y*bw + z*bx;
+		const A tz = w*bz + x*by - y*bx + z*bw;
+		w = tw;
+		x = tx;
+		y = ty;
+		z = tz;
+	}
+
+	public:
+	//tolerance: kept well below the tolerance of isRotation() (1e-6 in double), so the result always passes it
+	explicit RotationAccumulator(A tolerance = detail::rotationTolerance<A>/10): tolerance{tolerance} {}
+	explicit RotationAccumulator(const quaternion<T> &start, A tolerance = detail::rotationTolerance<A>/10)
+		: w{start.w()}, x{start.x()}, y{start.y()}, z{start.z()}, tolerance{tolerance} {
+		renormalize();
+	}
+
+	//result = result * q
+	RotationAccumulator<T, A>& compose(const quaternion<T> &q) {
+		multiply(q.w(), q.x(), q.y(), q.z());
+		renormalize();
+		return *this;
+	}
+	RotationAccumulator<T, A>& compose(const UnitQuaternion<T> &q) {
+		return compose(q.value());
+	}
+	RotationAccumulator<T, A>& compose(const RotationMatrix<T> &M) {
+		return compose(M.convertToQuaternion());
+	}
+	//Returns false (and composes nothing) if M is not a rotation matrix
+	bool compose(const Matrix3<T> &M) {
+		const std::optional<quaternion<T>> q = M.convertToQuaternion();
+		if(!q){
+			return false;
+		}
+		compose(q.value());
+		return true;
+	}
+
+	//result = result * q[0] * q[1] * ... * q[n-1], in one loop
+	RotationAccumulator<T, A>& composeAll(const quaternion<T> *q, std::size_t n) {
+		for(std::size_t i = 0; i < n; ++i){
+			multiply(q[i].w(), q[i].x(), q[i].y(), q[i].z());
+			renormalize();
+		}
+		return *this;
+	}
+
+	//rounded to T
+	quaternion<T> value() const {
+		return {static_cast<T>(w), static_cast<T>(x), static_cast<T>(y), static_cast<T>(z)};
+	}
+	UnitQuaternion<T> unitValue() const {
+		return UnitQuaternion<T>::fromQuaternion(value()).value();
+	}
+	RotationMatrix<T> matrix() const {
+		return unitValue().convertToMatrix();
+	}
+	//number of renormalizations (Newton or exact) so far
+	std::size_t renormalizationCount() const {
+		return renormalizations;
+	}
+};
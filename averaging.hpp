@@ -0,0 +1,215 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <optional>
+#include "quaternion.hpp"
+#include "rotationArrays.hpp"
+#include "parallel.hpp"
+#include "batchConversion.hpp"
+#include "eigen4.hpp"
+
+//Mean of many rotations, insensitive to the sign of the quaternions (q and -q are the same rotation).
+//The samples are summed into the 4x4 matrix sum w q q^T (Markley's method: the mean is its top eigenvector) and
+//into sum w s q, with s = +-1 flipping q into the hemisphere of the first sample (the chordal mean: that sum,
+//normalized). Adding and removing a sample costs O(1), so a sliding window keeps its mean up to date; arrays
+//are added in one pass that vectorizes, in chunks on a ThreadPool. float samples are summed in double.
+namespace detail
+{
+	template<typename S>
+	struct OuterSums{
+		std::array<S,10> outer{};  //upper triangle of sum w q q^T: ww wx wy wz xx xy xz yy yz zz
+		std::array<S,4> aligned{}; //sum w s q
+		S weight = 0;
+		S count = 0;
+		OuterSums& operator+=(const OuterSums &other) {
+			for(int k = 0; k < 10; ++k){
+				outer[k] += other.outer[k];
+			}
+			for(int k = 0; k < 4; ++k){
+				aligned[k] += other.aligned[k];
+			}
+			weight += other.weight;
+			count += other.count;
+			return *this;
+		}
+	};
+
+	//Sums over q[0, n) (weight[i], or 1 if weight is nullptr), skipping the quaternions that are not unit (as
+	//isRotation()); the others are normalized
+	template<typename S, typename T>
+	OuterSums<S> sumOuter(const T *qw, const T *qx, const T *qy, const T *qz, const T *weight, std::size_t n,
+	                      const std::array<S,4> &reference) {
+		OuterSums<S> sums;
+		auto pass = [&](auto weightOf){
+			batch::detail::run([&]{
+				constexpr std::size_t lanes = 32/sizeof(S); //one AVX2 register per sum
+				S so[10][lanes] = {}, sa[4][lanes] = {}, sw[lanes] = {}, sc[lanes] = {};
+				auto add = [&](std::size_t i, std::size_t l){
+					const bool valid = batch::detail::isUnitSquaredNorm(qw[i]*qw[i] + qx[i]*qx[i] + qy[i]*qy[i] + qz[i]*qz[i]);
+					//zeroed when not valid: the weight 0 alone does not cancel a NaN or an infinity (0*inf is NaN)
+					const S w = valid ? S(qw[i]) : S(0), x = valid ? S(qx[i]) : S(0), y = valid ? S(qy[i]) : S(0), z = valid ? S(qz[i]) : S(0);
+					const S inv = S(1)/std::sqrt(valid ? w*w + x*x + y*y + z*z : S(1));
+					const S a = valid ? S(weightOf(i)) : S(0);
+					const S sign = w*reference[0] + x*reference[1] + y*reference[2] + z*reference[3] < 0 ? S(-1) : S(1);
+					const S outerScale = a*inv*inv, alignedScale = sign*a*inv;
+					so[0][l] += outerScale*w*w; so[1][l] += outerScale*w*x; so[2][l] += outerScale*w*y; so[3][l] += outerScale*w*z;
+					so[4][l] += outerScale*x*x; so[5][l] += outerScale*x*y; so[6][l] += outerScale*x*z;
+					so[7][l] += outerScale*y*y; so[8][l] += outerScale*y*z;
+					so[9][l] += outerScale*z*z;
+					sa[0][l] += alignedScale*w; sa[1][l] += alignedScale*x; sa[2][l] += alignedScale*y; sa[3][l] += alignedScale*z;
+					sw[l] += a;
+					sc[l] += valid ? S(1) : S(0);
+				};
+				std::size_t i = 0;
+				for(; i + lanes <= n; i += lanes){
+					for(std::size_t l = 0; l < lanes; ++l){
+						add(i + l, l);
+					}
+				}
+				for(; i < n; ++i){
+					add(i, 0);
+				}
+				for(std::size_t l = 0; l < lanes; ++l){
+					for(int k = 0; k < 10; ++k){
+						sums.outer[k] += so[k][l];
+					}
+					for(int k = 0; k < 4; ++k){
+						sums.aligned[k] += sa[k][l];
+					}
+					sums.weight += sw[l];
+					sums.count += sc[l];
+				}
+			});
+		};
+		if(weight){
+			pass([weight](std::size_t i){ return weight[i]; });
+		}
+		else{
+			pass([](std::size_t){ return T(1); });
+		}
+		return sums;
+	}
+}
+
+template<typename T>
+class RotationAverage{
+	private:
+	using S = decltype(T() + 0.);
+	detail::OuterSums<S> sums;
+	std::array<S,4> reference{}; //hemisphere of the chordal mean: the first sample, kept until the average is empty
+	bool referenced = false;
+
+	void setReference(const quaternion<T> &q) {
+		if(!referenced){
+			reference = {S(q.w()), S(q.x()), S(q.y()), S(q.z())};
+			referenced = true;
+		}
+	}
+
+	void accumulate(const quaternion<T> &q, S weight, S count) {
+		setReference(q);
+		const S w = q.w(), x = q.x(), y = q.y(), z = q.z();
+		const S sign = w*reference[0] + x*reference[1] + y*reference[2] + z*reference[3] < 0 ? -weight : weight;
+		const std::array<S,10> outer{w*w, w*x, w*y, w*z, x*x, x*y, x*z, y*y, y*z, z*z};
+		for(int k = 0; k < 10; ++k){
+			sums.outer[k] += weight*outer[k];
+		}
+		sums.aligned[0] += sign*w;
+		sums.aligned[1] += sign*x;
+		sums.aligned[2] += sign*y;
+		sums.aligned[3] += sign*z;
+		sums.weight += weight;
+		sums.count += count;
+		if(sums.count == 0){
+			clear(); //drop the rounding left by add/remove
+		}
+	}
+
+	void addArray(const QuaternionArray<T> &q, const T *weight, const ParallelOptions &options) {
+		for(std::size_t i = 0; i < q.size() and !referenced; ++i){
+			if(q[i].isRotation()){
+				setReference(q[i]);
+			}
+		}
+		sums += parallelReduce<detail::OuterSums<S>>(q.size(), options, [&](std::size_t begin, std::size_t end){
+			return detail::sumOuter<S>(q.w() + begin, q.x() + begin, q.y() + begin, q.z() + begin,
+			                           weight ? weight + begin : nullptr, end - begin, reference);
+		});
+	}
+
+	public:
+	RotationAverage() = default;
+
+	//One sample; remove must get the sample and weight that add got (the sums drift by rounding over very long
+	//windows, but are reset exactly when the last sample is removed)
+	void add(const UnitQuaternion<T> &q, T weight = 1) {
+		accumulate(q.value(), S(weight), S(1));
+	}
+	void remove(const UnitQuaternion<T> &q, T weight = 1) {
+		accumulate(q.value(), -S(weight), S(-1));
+	}
+
+	//All the unit quaternions of q (the others are skipped), with weight 1 or weight[i] >= 0.
+	//Returns false (and adds nothing) if q and weight differ in size.
+	void add(const QuaternionArray<T> &q, const ParallelOptions &options = {}) {
+		addArray(q, nullptr, options);
+	}
+	bool add(const QuaternionArray<T> &q, const std::vector<T> &weight, const ParallelOptions &options = {}) {
+		if(weight.size() != q.size()){
+			return false;
+		}
+		addArray(q, weight.data(), options);
+		return true;
+	}
+
+	void clear() {
+		*this = RotationAverage<T>();
+	}
+	//number of samples, and their total weight
+	std::size_t size() const {
+		return static_cast<std::size_t>(sums.count);
+	}
+	S weight() const {
+		return sums.weight;
+	}
+
+	//Markley's mean: the rotation R minimizing sum w |R - R_i|^2 (Frobenius norm, the chordal distance of the
+	//matrices), i.e. maximizing sum w (q.q_i)^2. Fails if there are no samples or the maximum is not unique
+	//(e.g. two rotations by 180 degrees apart, equally weighted).
+	std::optional<UnitQuaternion<T>> mean() const {
+		if(sums.count <= 0){
+			return std::nullopt;
+		}
+		const auto &o = sums.outer;
+		const detail::Matrix4<S> M{{{o[0], o[1], o[2], o[3]},
+		                            {o[1], o[4], o[5], o[6]},
+		                            {o[2], o[5], o[7], o[8]},
+		                            {o[3], o[6], o[8], o[9]}}};
+		std::array<S,4> values;
+		detail::Matrix4<S> vectors;
+		detail::symmetricEigen4(M, values, vectors);
+		const S scale = std::max(std::abs(values[0]), std::abs(values[3]));
+		if(!(values[0] - values[1] > 1024*std::numeric_limits<S>::epsilon()*scale)){ //also false for NaN
+			return std::nullopt;
+		}
+		const S sign = vectors[0][0] < 0 ? S(-1) : S(1); //w >= 0
+		return UnitQuaternion<T>::fromQuaternion({T(sign*vectors[0][0]), T(sign*vectors[1][0]), T(sign*vectors[2][0]), T(sign*vectors[3][0])});
+	}
+
+	//Chordal L2 mean of the quaternions, flipped into the hemisphere of the first sample: their weighted sum,
+	//normalized, minimizes sum w |q - s q_i|^2. No eigen solve; close to mean() (equal for two samples, or samples
+	//symmetric about the mean) while the samples are within 90 degrees of the first one.
+	//Fails if there are no samples or they cancel out.
+	std::optional<UnitQuaternion<T>> chordalMean() const {
+		const auto &a = sums.aligned;
+		const S norm = std::sqrt(a[0]*a[0] + a[1]*a[1] + a[2]*a[2] + a[3]*a[3]);
+		if(sums.count <= 0 or !(norm > 1024*std::numeric_limits<S>::epsilon()*std::abs(sums.weight))){
+			return std::nullopt;
+		}
+		const S sign = a[0] < 0 ? -1/norm : 1/norm; //w >= 0
+		return UnitQuaternion<T>::fromQuaternion({T(sign*a[0]), T(sign*a[1]), T(sign*a[2]), T(sign*a[3])});
+	}
+};
@@ -7,6 +7,7 @@
 #include <cmath>
 #include "matrix.hpp"
 #include "quaternion.hpp"
+#include "fastMath.hpp"
 
 template<typename T>
 class Matrix3;
@@ -19,12 +20,12 @@ class axisAngle{
 	std::array<T,3> axis; // axis coordinates
 	T angle;
 	public:
-	axisAngle(): axis{}, angle{0}{} //default const 
+	constexpr axisAngle(): axis{}, angle{0}{} //default const 
     /**
 	*  Constructor
     */
-	axisAngle(std::array<T,3> vec, T a): axis{vec}, angle(a) {}; //init.  from vector + angle 
-	axisAngle(T _v1, T _v2, T _v3, T _v4): axis{{_v1, _v2, _v3}}, angle(_v4) {}; //init.  from 4 numbers
+	constexpr axisAngle(std::array<T,3> vec, T a): axis{vec}, angle(a) {}; //init.  from vector + angle 
+	constexpr axisAngle(T _v1, T _v2, T _v3, T _v4): axis{{_v1, _v2, _v3}}, angle(_v4) {}; //init.  from 4 numbers
 	//axisAngle(std::initializer_list<T> const& il, T a):   axis{il}, angle(a) {}; //init from init list + number
 	
 	axisAngle( axisAngle const& ) = default; //copy const       
@@ -32,34 +33,37 @@ class axisAngle{
 	
 	axisAngle<T>& operator=(axisAngle const&) = default;
 
-	T x() const {
+	constexpr T x() const {
 		return axis[0];
 	}
-	T y() const {
+	constexpr T y() const {
 		return axis[1];
 	}
-	T z() const {
+	constexpr T z() const {
 		return axis[2];
 	} 
-	T getAngle() const {
+	constexpr T getAngle() const {
 		return angle;
 	}
 	
-	bool isRotation() const {
-		return (std::inner_product(axis.begin(), axis.end(), axis.begin(), 0.)!=0 and getAngle() != 0);  // if axis, angle is not zero.
+	constexpr bool isRotation() const {
+		return ((x()*x() + y()*y() + z()*z())!=0 and getAngle() != 0);  // if axis, angle is not zero.
 	}
 
-	//conversion functions: 
+	//conversion functions (Trig: StdTrig or FastTrig, see fastMath.hpp): 
 
+	template<typename Trig = StdTrig>
 	std::optional<Matrix3<T>> convertToMatrix() const {
 		if(!isRotation()){
 			return std::nullopt;
 		}
 		else{
-
-			T c = std::cos(getAngle());
-			T s = std::sin(getAngle());
-			T C = 1. - c;
+			//From the half angle: one sincos, and 1 - cos = 2 sin^2(angle/2) has no cancellation for small angles
+			T sh, ch;
+			Trig::sincos(getAngle()/2, sh, ch);
+			T s = 2*sh*ch;
+			T C = 2*sh*sh;
+			T c = T(1) - C;
 			T a11 = x()*x()*C + c; T a12 = x()*y()*C - z()*s; T a13 = x()*z()*C + y()*s;
 			T a21 = y()*x()*C + z()*s; T a22 = y()*y()*C + c; T a23 = y()*z()*C - x()*s;
 			T a31 = z()*x()*C - y()*s; T a32 = z()*y()*C + x()*s; T a33 = z()*z()*C + c;
@@ -68,14 +72,15 @@ class axisAngle{
 		}
 	}
 
+	template<typename Trig = StdTrig>
 	std::optional<quaternion<T>> convertToQuaternion() const {
 		if(!isRotation()){
 			return std::nullopt;
 		}
 		else{
-			T c = std::cos(getAngle()/2.);
-			T s = std::sin(getAngle()/2.);
-			quaternion<double> result  {c, x()*s, y()*s, z()*s}; 
+			T s, c;
+			Trig::sincos(getAngle()/2, s, c);
+			quaternion<T> result  {c, x()*s, y()*s, z()*s}; 
 			return result;
 		}
 	}
@@ -90,6 +95,6 @@ std::optional<std::array<T,3>> rotateByAngle(const axisAngle<T> &a, const std::a
 		return std::nullopt;
 	} 
 	else {
-		return rotateByQuaternion(proxy, r);
+		return rotateByQuaternion(*proxy, r);
 	}
 }
\ No newline at end of file
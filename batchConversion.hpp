@@ -0,0 +1,229 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include "rotationArrays.hpp"
+#include "fastMath.hpp"
+#include "kernels.hpp"
+#include "parallel.hpp"
+
+//Batch conversions between arrays of quaternions, matrices and axis-angles (structure of arrays).
+//Each loop body is branch-free (selects, and & in place of the short-circuiting and) and uses the fastmath
+//sin/cos/atan2, so the loops vectorize. GCC needs -fno-math-errno for sqrt and -fno-trapping-math for
+//selects on <, > (both set in CMakeLists.txt); the loops run in an AVX2 build when the CPU has it.
+//Validity follows the isRotation() of the scalar classes and is reported in a mask instead of std::optional.
+//Outputs are resized to the input size (no allocation if they already have it).
+namespace batch
+{
+	namespace detail
+	{
+		//body(i) for i in [0, n), in a loop the compiler may vectorize: the arrays used by body must not overlap
+		template<typename F>
+		ROTATIONS_FLATTEN inline void forEachDefault(std::size_t n, F body) {
+			ROTATIONS_IVDEP
+			for(std::size_t i = 0; i < n; ++i){
+				body(i);
+			}
+		}
+
+#if ROTATIONS_X86_DISPATCH
+		//The same loop built for AVX2, used when the CPU has it: SSE2 cannot vectorize the validity masks
+		//(a double comparison stored to a byte)
+		template<typename F>
+		__attribute__((target("avx2"), flatten)) inline void forEachAvx2(std::size_t n, F body) {
+			ROTATIONS_IVDEP
+			for(std::size_t i = 0; i < n; ++i){
+				body(i);
+			}
+		}
+#endif
+
+		template<typename F>
+		inline void forEach(std::size_t n, F body) {
+#if ROTATIONS_X86_DISPATCH
+			if(simd::activeIsa() >= simd::Isa::avx2){
+				forEachAvx2(n, body);
+				return;
+			}
+#endif
+			forEachDefault(n, body);
+		}
+
+#if ROTATIONS_X86_DISPATCH
+		template<typename F>
+		__attribute__((target("avx2"), flatten)) inline void runAvx2(F f) { //flatten: f must be inlined to be built for AVX2
+			f();
+		}
+#endif
+
+		//f() built for AVX2 when the CPU has it: for loops forEach cannot take, whose iterations depend on each
+		//other (reductions into lanes of partial sums)
+		template<typename F>
+		inline void run(F f) {
+#if ROTATIONS_X86_DISPATCH
+			if(simd::activeIsa() >= simd::Isa::avx2){
+				runAvx2(f);
+				return;
+			}
+#endif
+			f();
+		}
+
+		//f(begin, end) over [0, n): at once, or in chunks on options.pool
+		template<typename F>
+		inline void forChunks(std::size_t n, const ParallelOptions &options, F f) {
+			if(!options.pool){
+				f(std::size_t(0), n);
+				return;
+			}
+			options.pool->parallelFor(n, options.chunkSize, f);
+		}
+
+		//Same test as isRotation(): |norm - 1| < tolerance, on the squared norm to avoid the sqrt
+		template<typename T>
+		inline bool isUnitSquaredNorm(T n2) {
+			constexpr T tolerance = ::detail::rotationTolerance<T>;
+			return (n2 > (1 - tolerance)*(1 - tolerance)) & (n2 < (1 + tolerance)*(1 + tolerance));
+		}
+
+		//Same test as Matrix3::isRotation(): |det - 1| < tolerance and M^T M = I to within the tolerance
+		template<typename T>
+		inline bool isRotationMatrix(T m00, T m01, T m02, T m10, T m11, T m12, T m20, T m21, T m22) {
+			constexpr T tolerance = ::detail::rotationTolerance<T>;
+			const T det = m00*(m11*m22 - m21*m12) - m01*(m10*m22 - m12*m20) + m02*(m10*m21 - m11*m20);
+			const T c00 = m00*m00 + m10*m10 + m20*m20 - T(1), c11 = m01*m01 + m11*m11 + m21*m21 - T(1), c22 = m02*m02 + m12*m12 + m22*m22 - T(1);
+			const T c01 = m00*m01 + m10*m11 + m20*m21, c02 = m00*m02 + m10*m12 + m20*m22, c12 = m01*m02 + m11*m12 + m21*m22;
+			return (std::abs(det - T(1)) < tolerance) & (std::abs(c00) < tolerance) & (std::abs(c11) < tolerance) & (std::abs(c22) < tolerance)
+			     & (std::abs(c01) < tolerance) & (std::abs(c02) < tolerance) & (std::abs(c12) < tolerance);
+		}
+
+		//angle = 2 atan2(|v|, w), axis = v / |v|; the axis is 0 if |v| = 0
+		template<typename T>
+		inline void quaternionToAxisAngle(T w, T x, T y, T z, T &ax, T &ay, T &az, T &angle, T &vNorm) {
+			vNorm = std::sqrt(x*x + y*y + z*z);
+			const T inv = vNorm > T(0) ? T(1)/(vNorm > T(0) ? vNorm : T(1)) : T(0); //no division under a condition
+			ax = x*inv;
+			ay = y*inv;
+			az = z*inv;
+			angle = T(2)*fastmath::atan2(vNorm, w);
+		}
+	}
+
+	//quaternion -> matrix, always valid (as quaternion::convertToMatrix)
+	template<typename T>
+	void convertToMatrix(const QuaternionArray<T> &q, MatrixArray<T> &M) {
+		const std::size_t n = q.size();
+		M.resize(n);
+		const T *qw = q.w(), *qx = q.x(), *qy = q.y(), *qz = q.z();
+		T *m00 = M(0, 0), *m01 = M(0, 1), *m02 = M(0, 2);
+		T *m10 = M(1, 0), *m11 = M(1, 1), *m12 = M(1, 2);
+		T *m20 = M(2, 0), *m21 = M(2, 1), *m22 = M(2, 2);
+		detail::forEach(n, [=](std::size_t i){
+			const T w = qw[i], x = qx[i], y = qy[i], z = qz[i];
+			m00[i] = T(-1) + 2*x*x + 2*w*w; m01[i] = 2*(x*y - z*w);        m02[i] = 2*(x*z + y*w);
+			m10[i] = 2*(x*y + z*w);        m11[i] = T(-1) + 2*y*y + 2*w*w; m12[i] = 2*(y*z - x*w);
+			m20[i] = 2*(x*z - y*w);        m21[i] = 2*(x*w + y*z);        m22[i] = T(-1) + 2*z*z + 2*w*w;
+		});
+	}
+
+	//quaternion -> axis-angle, valid for unit quaternions
+	template<typename T>
+	void convertToAxisAngle(const QuaternionArray<T> &q, AxisAngleArray<T> &a, ValidityMask &valid) {
+		const std::size_t n = q.size();
+		a.resize(n);
+		valid.resize(n);
+		const T *qw = q.w(), *qx = q.x(), *qy = q.y(), *qz = q.z();
+		T *ax = a.x(), *ay = a.y(), *az = a.z(), *angle = a.angle();
+		std::uint8_t *ok = valid.data();
+		detail::forEach(n, [=](std::size_t i){
+			const T w = qw[i], x = qx[i], y = qy[i], z = qz[i];
+			T vNorm;
+			detail::quaternionToAxisAngle(w, x, y, z, ax[i], ay[i], az[i], angle[i], vNorm);
+			ok[i] = detail::isUnitSquaredNorm(w*w + x*x + y*y + z*z);
+		});
+	}
+
+	//matrix -> quaternion, valid for rotation matrices
+	template<typename T>
+	void convertToQuaternion(const MatrixArray<T> &M, QuaternionArray<T> &q, ValidityMask &valid) {
+		const std::size_t n = M.size();
+		q.resize(n);
+		valid.resize(n);
+		const T *m00 = M(0, 0), *m01 = M(0, 1), *m02 = M(0, 2);
+		const T *m10 = M(1, 0), *m11 = M(1, 1), *m12 = M(1, 2);
+		const T *m20 = M(2, 0), *m21 = M(2, 1), *m22 = M(2, 2);
+		T *qw = q.w(), *qx = q.x(), *qy = q.y(), *qz = q.z();
+		std::uint8_t *ok = valid.data();
+		detail::forEach(n, [=](std::size_t i){
+			::detail::matrixToQuaternion(m00[i], m01[i], m02[i], m10[i], m11[i], m12[i], m20[i], m21[i], m22[i],
+			                           qw[i], qx[i], qy[i], qz[i]);
+			ok[i] = detail::isRotationMatrix(m00[i], m01[i], m02[i], m10[i], m11[i], m12[i], m20[i], m21[i], m22[i]);
+		});
+	}
+
+	//matrix -> axis-angle, valid for rotation matrices other than the identity (no axis).
+	//Goes through the quaternion, so it also handles rotations by pi, and angles in [0, pi].
+	template<typename T>
+	void convertToAxisAngle(const MatrixArray<T> &M, AxisAngleArray<T> &a, ValidityMask &valid) {
+		const std::size_t n = M.size();
+		a.resize(n);
+		valid.resize(n);
+		const T *m00 = M(0, 0), *m01 = M(0, 1), *m02 = M(0, 2);
+		const T *m10 = M(1, 0), *m11 = M(1, 1), *m12 = M(1, 2);
+		const T *m20 = M(2, 0), *m21 = M(2, 1), *m22 = M(2, 2);
+		T *ax = a.x(), *ay = a.y(), *az = a.z(), *angle = a.angle();
+		std::uint8_t *ok = valid.data();
+		detail::forEach(n, [=](std::size_t i){
+			T w, x, y, z, vNorm;
+			::detail::matrixToQuaternion(m00[i], m01[i], m02[i], m10[i], m11[i], m12[i], m20[i], m21[i], m22[i], w, x, y, z);
+			detail::quaternionToAxisAngle(w, x, y, z, ax[i], ay[i], az[i], angle[i], vNorm);
+			ok[i] = detail::isRotationMatrix(m00[i], m01[i], m02[i], m10[i], m11[i], m12[i], m20[i], m21[i], m22[i])
+			        & (vNorm > T(0));
+		});
+	}
+
+	//axis-angle -> matrix, valid if the axis and the angle are not zero (as axisAngle::isRotation)
+	template<typename T>
+	void convertToMatrix(const AxisAngleArray<T> &a, MatrixArray<T> &M, ValidityMask &valid) {
+		const std::size_t n = a.size();
+		M.resize(n);
+		valid.resize(n);
+		const T *ax = a.x(), *ay = a.y(), *az = a.z(), *angle = a.angle();
+		T *m00 = M(0, 0), *m01 = M(0, 1), *m02 = M(0, 2);
+		T *m10 = M(1, 0), *m11 = M(1, 1), *m12 = M(1, 2);
+		T *m20 = M(2, 0), *m21 = M(2, 1), *m22 = M(2, 2);
+		std::uint8_t *ok = valid.data();
+		detail::forEach(n, [=](std::size_t i){
+			const T x = ax[i], y = ay[i], z = az[i];
+			T s, c;
+			fastmath::sincos(angle[i], s, c);
+			const T C = T(1) - c;
+			m00[i] = x*x*C + c;   m01[i] = x*y*C - z*s; m02[i] = x*z*C + y*s;
+			m10[i] = y*x*C + z*s; m11[i] = y*y*C + c;   m12[i] = y*z*C - x*s;
+			m20[i] = z*x*C - y*s; m21[i] = z*y*C + x*s; m22[i] = z*z*C + c;
+			ok[i] = ((x*x + y*y + z*z) != T(0)) & (angle[i] != T(0));
+		});
+	}
+
+	//axis-angle -> quaternion, valid if the axis and the angle are not zero (as axisAngle::isRotation)
+	template<typename T>
+	void convertToQuaternion(const AxisAngleArray<T> &a, QuaternionArray<T> &q, ValidityMask &valid) {
+		const std::size_t n = a.size();
+		q.resize(n);
+		valid.resize(n);
+		const T *ax = a.x(), *ay = a.y(), *az = a.z(), *angle = a.angle();
+		T *qw = q.w(), *qx = q.x(), *qy = q.y(), *qz = q.z();
+		std::uint8_t *ok = valid.data();
+		detail::forEach(n, [=](std::size_t i){
+			const T x = ax[i], y = ay[i], z = az[i];
+			T s, c;
+			fastmath::sincos(angle[i]/T(2), s, c);
+			qw[i] = c;
+			qx[i] = x*s;
+			qy[i] = y*s;
+			qz[i] = z*s;
+			ok[i] = ((x*x + y*y + z*z) != T(0)) & (angle[i] != T(0));
+		});
+	}
+}
@@ -0,0 +1,136 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include "rotationArrays.hpp"
+#include "batchConversion.hpp"
+#include "points.hpp"
+#include "parallel.hpp"
+
+//Per-point rotations: point i rotated by rotation i (particles), or by a weighted blend of a few rotations out of
+//a palette (skinning). Same conventions as batchConversion.hpp: branch-free loop bodies that vectorize, validity
+//in a mask. out is resized to the size of in and may be in itself; with options.pool set, the points are split
+//into chunks rotated in parallel, with the same result as the serial loop.
+namespace batch
+{
+	namespace detail
+	{
+		//The loop of blend; K: rotations per point if known at compile time, 0 if not (perPoint then)
+		template<std::size_t K, typename T>
+		void blendInto(const MatrixArray<T> &palette, const std::uint32_t *bone, const T *w, std::size_t perPoint,
+		               const Points<T> &in, Points<T> &out, const ParallelOptions &options) {
+			const std::size_t count = K > 0 ? K : perPoint;
+			const T *m00 = palette(0, 0), *m01 = palette(0, 1), *m02 = palette(0, 2);
+			const T *m10 = palette(1, 0), *m11 = palette(1, 1), *m12 = palette(1, 2);
+			const T *m20 = palette(2, 0), *m21 = palette(2, 1), *m22 = palette(2, 2);
+			const T *x = in.x(), *y = in.y(), *z = in.z();
+			T *xOut = out.x(), *yOut = out.y(), *zOut = out.z();
+			forChunks(in.size(), options, [=](std::size_t begin, std::size_t end){
+				forEach(end - begin, [=](std::size_t j){
+					const std::size_t i = begin + j;
+					const T px = x[i], py = y[i], pz = z[i];
+					T rx = 0, ry = 0, rz = 0;
+					for(std::size_t k = 0; k < count; ++k){
+						const std::uint32_t b = bone[i*count + k];
+						const T a = w[i*count + k];
+						rx += a*(m00[b]*px + m01[b]*py + m02[b]*pz);
+						ry += a*(m10[b]*px + m11[b]*py + m12[b]*pz);
+						rz += a*(m20[b]*px + m21[b]*py + m22[b]*pz);
+					}
+					xOut[i] = rx;
+					yOut[i] = ry;
+					zOut[i] = rz;
+				});
+			});
+		}
+	}
+
+	//out[i] = q[i] in[i] q[i]^-1, valid[i] == 1 if q[i] is a unit quaternion (out[i] is meaningless otherwise).
+	//Returns false (and leaves out and valid untouched) if q and in differ in size.
+	template<typename T>
+	bool rotate(const QuaternionArray<T> &q, const Points<T> &in, Points<T> &out, ValidityMask &valid, const ParallelOptions &options = {}) {
+		const std::size_t n = in.size();
+		if(q.size() != n){
+			return false;
+		}
+		out.resize(n);
+		valid.resize(n);
+		const T *qw = q.w(), *qx = q.x(), *qy = q.y(), *qz = q.z();
+		const T *x = in.x(), *y = in.y(), *z = in.z();
+		T *xOut = out.x(), *yOut = out.y(), *zOut = out.z();
+		std::uint8_t *ok = valid.data();
+		detail::forChunks(n, options, [=](std::size_t begin, std::size_t end){
+			detail::forEach(end - begin, [=](std::size_t j){
+				const std::size_t i = begin + j;
+				const T w = qw[i], u = qx[i], v = qy[i], s = qz[i];
+				const T px = x[i], py = y[i], pz = z[i];
+				const T tx = 2*(v*pz - s*py), ty = 2*(s*px - u*pz), tz = 2*(u*py - v*px); //as UnitQuaternion::apply
+				xOut[i] = px + w*tx + (v*tz - s*ty);
+				yOut[i] = py + w*ty + (s*tx - u*tz);
+				zOut[i] = pz + w*tz + (u*ty - v*tx);
+				ok[i] = detail::isUnitSquaredNorm(w*w + u*u + v*v + s*s);
+			});
+		});
+		return true;
+	}
+
+	//out[i] = M[i] in[i], valid[i] == 1 if M[i] is a rotation (orthonormal with det 1, as Matrix3::isRotation); the product is
+	//computed either way. Returns false (and leaves out and valid untouched) if M and in differ in size.
+	template<typename T>
+	bool rotate(const MatrixArray<T> &M, const Points<T> &in, Points<T> &out, ValidityMask &valid, const ParallelOptions &options = {}) {
+		const std::size_t n = in.size();
+		if(M.size() != n){
+			return false;
+		}
+		out.resize(n);
+		valid.resize(n);
+		const T *m00 = M(0, 0), *m01 = M(0, 1), *m02 = M(0, 2);
+		const T *m10 = M(1, 0), *m11 = M(1, 1), *m12 = M(1, 2);
+		const T *m20 = M(2, 0), *m21 = M(2, 1), *m22 = M(2, 2);
+		const T *x = in.x(), *y = in.y(), *z = in.z();
+		T *xOut = out.x(), *yOut = out.y(), *zOut = out.z();
+		std::uint8_t *ok = valid.data();
+		detail::forChunks(n, options, [=](std::size_t begin, std::size_t end){
+			detail::forEach(end - begin, [=](std::size_t j){
+				const std::size_t i = begin + j;
+				const T px = x[i], py = y[i], pz = z[i];
+				xOut[i] = m00[i]*px + m01[i]*py + m02[i]*pz;
+				yOut[i] = m10[i]*px + m11[i]*py + m12[i]*pz;
+				zOut[i] = m20[i]*px + m21[i]*py + m22[i]*pz;
+				ok[i] = detail::isRotationMatrix(m00[i], m01[i], m02[i], m10[i], m11[i], m12[i], m20[i], m21[i], m22[i]);
+			});
+		});
+		return true;
+	}
+
+	//Linear blend skinning: out[i] = sum over k < perPoint of weight[i*perPoint + k] palette[index[i*perPoint + k]] in[i].
+	//The weights are used as given (normally they sum to 1), and the palette need not hold rotations; a palette of
+	//quaternions is converted first with batch::convertToMatrix.
+	//Returns false (and leaves out untouched) if index or weight do not have perPoint entries per point, or an
+	//index is not in the palette.
+	template<typename T>
+	bool blend(const MatrixArray<T> &palette, const std::vector<std::uint32_t> &index, const std::vector<T> &weight, std::size_t perPoint,
+	           const Points<T> &in, Points<T> &out, const ParallelOptions &options = {}) {
+		const std::size_t n = in.size();
+		if(perPoint == 0 or index.size() != n*perPoint or weight.size() != n*perPoint){
+			return false;
+		}
+		std::uint32_t largest = 0;
+		for(std::uint32_t k : index){
+			largest = std::max(largest, k);
+		}
+		if(n > 0 and largest >= palette.size()){
+			return false;
+		}
+		out.resize(n);
+		switch(perPoint){ //a fixed count unrolls the inner loop, so that the loop over the points vectorizes
+			case 1: detail::blendInto<1>(palette, index.data(), weight.data(), perPoint, in, out, options); break;
+			case 2: detail::blendInto<2>(palette, index.data(), weight.data(), perPoint, in, out, options); break;
+			case 3: detail::blendInto<3>(palette, index.data(), weight.data(), perPoint, in, out, options); break;
+			case 4: detail::blendInto<4>(palette, index.data(), weight.data(), perPoint, in, out, options); break;
+			default: detail::blendInto<0>(palette, index.data(), weight.data(), perPoint, in, out, options);
+		}
+		return true;
+	}
+}
@@ -0,0 +1,684 @@
+//Microbenchmarks: rotation_bench [--benchmark_filter=<substring>] [--benchmark_min_time=<seconds>]
+//                                 [--benchmark_format=console|json] [--benchmark_out=<file>]
+//Output follows Google Benchmark's: time per operation in ns, and items (points, vectors) per second.
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <cmath>
+#include <random>
+#include "matrix.hpp"
+#include "quaternion.hpp"
+#include "axisAngle.hpp"
+#include "kernels.hpp"
+#include "points.hpp"
+#include "parallel.hpp"
+#include "accumulator.hpp"
+#include "batchConversion.hpp"
+#include "interpolation.hpp"
+#include "rotationTable.hpp"
+#include "batchRotation.hpp"
+#include "fitting.hpp"
+#include "averaging.hpp"
+#include "orientationIndex.hpp"
+#include "randomRotations.hpp"
+
+//Keeps the compiler from optimizing away a result (or from constant-folding an input)
+template<typename T>
+void doNotOptimize(T const& value) {
+#if defined(__GNUC__) || defined(__clang__)
+	asm volatile("" : : "g"(&value) : "memory");
+#else
+	static volatile const void *sink;
+	sink = &value;
+#endif
+}
+
+//Setup before the loop is not timed:  while(state.keepRunning()){ ... }
+class State{
+	private:
+	bool started = false;
+	std::size_t left = 0;
+	std::chrono::steady_clock::time_point start;
+	public:
+	std::size_t iterations = 1;
+	double itemsPerIteration = 1; //vectors, points or objects handled by one iteration
+	double elapsed = 0; //seconds
+
+	bool keepRunning() {
+		if(!started){
+			started = true;
+			left = iterations;
+			start = std::chrono::steady_clock::now();
+		}
+		if(left == 0){
+			elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			return false;
+		}
+		--left;
+		return true;
+	}
+};
+
+struct Benchmark{
+	std::string name;
+	std::function<void(State&)> run;
+};
+
+struct Result{
+	std::string name;
+	std::size_t iterations;
+	double nsPerOp;
+	double itemsPerSecond;
+};
+
+std::vector<Benchmark>& registry() {
+	static std::vector<Benchmark> benchmarks;
+	return benchmarks;
+}
+
+void registerBenchmark(const std::string &name, std::function<void(State&)> run) {
+	registry().push_back({name, std::move(run)});
+}
+
+//Grows the iteration count until one run takes at least minTime
+Result measure(const Benchmark &benchmark, double minTime) {
+	std::size_t iterations = 1;
+	while(true){
+		State state;
+		state.iterations = iterations;
+		benchmark.run(state);
+		const double elapsed = state.elapsed;
+		if(elapsed >= minTime or iterations >= (std::size_t(1) << 40)){
+			double perOp = elapsed / static_cast<double>(iterations);
+			return {benchmark.name, iterations, 1e9*perOp, state.itemsPerIteration / perOp};
+		}
+		std::size_t next = elapsed > 0 ? static_cast<std::size_t>(1.4*minTime/elapsed*static_cast<double>(iterations)) : 0;
+		iterations = std::max(2*iterations, std::min(next, 100*iterations));
+	}
+}
+
+std::string toJson(const std::vector<Result> &results) {
+	std::ostringstream out;
+	out << std::setprecision(10);
+	out << "{\n  \"context\": {\n    \"num_cpus\": " << std::thread::hardware_concurrency()
+	    << ",\n    \"simd_isa\": " << static_cast<int>(simd::activeIsa()) << "\n  },\n  \"benchmarks\": [\n";
+	for(std::size_t i = 0; i < results.size(); ++i){
+		const Result &r = results[i];
+		out << "    {\n      \"name\": \"" << r.name << "\",\n      \"iterations\": " << r.iterations
+		    << ",\n      \"real_time\": " << r.nsPerOp << ",\n      \"time_unit\": \"ns\",\n      \"items_per_second\": "
+		    << r.itemsPerSecond << "\n    }" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	out << "  ]\n}\n";
+	return out.str();
+}
+
+void printConsole(const Result &r) {
+	std::cout << std::left << std::setw(48) << r.name << std::right << std::setw(14) << std::fixed << std::setprecision(2)
+	          << r.nsPerOp << " ns" << std::setw(14) << r.iterations << std::setw(14) << std::scientific
+	          << std::setprecision(3) << r.itemsPerSecond << " items/s\n" << std::defaultfloat;
+}
+
+//Inputs:
+const axisAngle<double> sampleAxisAngle({1./std::sqrt(2), 1./std::sqrt(2), 0.}, 0.7);
+const quaternion<double> sampleQuaternion = sampleAxisAngle.convertToQuaternion().value();
+const Matrix3<double> sampleMatrix = sampleQuaternion.convertToMatrix();
+
+Points<double> makeCloud(std::size_t n) {
+	Points<double> cloud;
+	cloud.resize(n);
+	for(std::size_t i = 0; i < n; ++i){
+		cloud.x()[i] = std::cos(0.001*static_cast<double>(i));
+		cloud.y()[i] = std::sin(0.003*static_cast<double>(i));
+		cloud.z()[i] = 1e-6*static_cast<double>(i);
+	}
+	return cloud;
+}
+
+std::string sizeName(std::size_t n) {
+	return n >= (1 << 20) ? std::to_string(n >> 20) + "M" : n >= (1 << 10) ? std::to_string(n >> 10) + "K" : std::to_string(n);
+}
+
+template<typename F>
+void addSingle(const std::string &name, F f) {
+	registerBenchmark(name, [f](State &state){
+		while(state.keepRunning()){
+			doNotOptimize(f());
+		}
+	});
+}
+
+void registerBenchmarks() {
+	//Conversions
+	addSingle("BM_quaternion_convertToMatrix", []{ auto q = sampleQuaternion; doNotOptimize(q); return q.convertToMatrix(); });
+	addSingle("BM_quaternion_convertToAxisAngle", []{ auto q = sampleQuaternion; doNotOptimize(q); return q.convertToAxisAngle(); });
+	addSingle("BM_matrix_convertToQuaternion", []{ auto m = sampleMatrix; doNotOptimize(m); return m.convertToQuaternion(); });
+	addSingle("BM_matrix_convertToQuaternion_divideByX", []{ //the former method: NaN at the identity, 1.8e-4 worst error on a sweep
+		auto m = sampleMatrix;
+		doNotOptimize(m);
+		const double x = 0.5*std::sqrt(1 + m(0, 0) - m(1, 1) - m(2, 2));
+		return quaternion<double>{(m(2, 1) - m(1, 2))/(4*x), x, (m(0, 1) + m(1, 0))/(4*x), (m(0, 2) + m(2, 0))/(4*x)};
+	});
+	addSingle("BM_matrix_convertToAxisAngle", []{ auto m = sampleMatrix; doNotOptimize(m); return m.convertToAxisAngle(); });
+	addSingle("BM_axisAngle_convertToMatrix", []{ auto a = sampleAxisAngle; doNotOptimize(a); return a.convertToMatrix(); });
+	addSingle("BM_axisAngle_convertToQuaternion", []{ auto a = sampleAxisAngle; doNotOptimize(a); return a.convertToQuaternion(); });
+
+	//The same with the FastTrig policy, and at a small angle (the Taylor branch)
+	const axisAngle<double> smallAxisAngle({1./std::sqrt(2), 1./std::sqrt(2), 0.}, 0.01);
+	addSingle("BM_quaternion_convertToAxisAngle_fast", []{ auto q = sampleQuaternion; doNotOptimize(q); return q.convertToAxisAngle<FastTrig>(); });
+	addSingle("BM_matrix_convertToAxisAngle_fast", []{ auto m = sampleMatrix; doNotOptimize(m); return m.convertToAxisAngle<FastTrig>(); });
+	addSingle("BM_axisAngle_convertToMatrix_fast", []{ auto a = sampleAxisAngle; doNotOptimize(a); return a.convertToMatrix<FastTrig>(); });
+	addSingle("BM_axisAngle_convertToQuaternion_fast", []{ auto a = sampleAxisAngle; doNotOptimize(a); return a.convertToQuaternion<FastTrig>(); });
+	addSingle("BM_axisAngle_convertToMatrix_small", [smallAxisAngle]{ auto a = smallAxisAngle; doNotOptimize(a); return a.convertToMatrix(); });
+	addSingle("BM_axisAngle_convertToMatrix_small_fast", [smallAxisAngle]{ auto a = smallAxisAngle; doNotOptimize(a); return a.convertToMatrix<FastTrig>(); });
+
+	//Batch conversions, against the loops of scalar conversions above
+	{
+		const std::size_t n = std::size_t(1) << 16;
+		auto makeAxisAngles = [n]{
+			AxisAngleArray<double> a;
+			for(std::size_t i = 0; i < n; ++i){
+				const double t = 0.001*static_cast<double>(i);
+				a.push_back(axisAngle<double>(std::cos(t)*std::sin(3*t), std::sin(t)*std::sin(3*t), std::cos(3*t), -3. + 6e-5*static_cast<double>(i)));
+			}
+			return a;
+		};
+		registerBenchmark("BM_batch_axisAngle_convertToMatrix/" + sizeName(n), [n, makeAxisAngles](State &state){
+			AxisAngleArray<double> a = makeAxisAngles();
+			MatrixArray<double> M(n);
+			ValidityMask valid(n);
+			state.itemsPerIteration = static_cast<double>(n);
+			while(state.keepRunning()){
+				batch::convertToMatrix(a, M, valid);
+				doNotOptimize(M(2, 2)[n - 1]);
+			}
+		});
+		registerBenchmark("BM_batch_matrix_convertToQuaternion/" + sizeName(n), [n, makeAxisAngles](State &state){
+			MatrixArray<double> M;
+			ValidityMask valid;
+			batch::convertToMatrix(makeAxisAngles(), M, valid);
+			QuaternionArray<double> q(n);
+			state.itemsPerIteration = static_cast<double>(n);
+			while(state.keepRunning()){
+				batch::convertToQuaternion(M, q, valid);
+				doNotOptimize(q.w()[n - 1]);
+			}
+		});
+		registerBenchmark("BM_batch_quaternion_convertToAxisAngle/" + sizeName(n), [n, makeAxisAngles](State &state){
+			QuaternionArray<double> q;
+			ValidityMask valid;
+			batch::convertToQuaternion(makeAxisAngles(), q, valid);
+			AxisAngleArray<double> a(n);
+			state.itemsPerIteration = static_cast<double>(n);
+			while(state.keepRunning()){
+				batch::convertToAxisAngle(q, a, valid);
+				doNotOptimize(a.angle()[n - 1]);
+			}
+		});
+	}
+
+	//Composition
+	addSingle("BM_quaternion_compose", []{ auto a = sampleQuaternion, b = sampleQuaternion; doNotOptimize(a); doNotOptimize(b); return quaternion<double>(a*b); });
+	addSingle("BM_matrix_compose", []{ auto a = sampleMatrix, b = sampleMatrix; doNotOptimize(a); doNotOptimize(b); return Matrix3<double>(a*b); });
+	//Chains of 3 matrices, each applied to one vector: checked (multiplied out once inside operator*), against
+	//multiplying the matrices out first, and unchecked right to left with apply()
+	{
+		std::vector<Matrix3<double>> matrices;
+		for(int i = 0; i < 64; ++i){
+			matrices.push_back(*axisAngle<double>(0.6, 0., 0.8, 0.1 + 0.01*i).convertToMatrix());
+		}
+		const std::size_t n = 1 << 10;
+		registerBenchmark("BM_matrix_chain3_apply/" + sizeName(n), [matrices, n](State &state){
+			std::vector<std::array<double,3>> out(n);
+			state.itemsPerIteration = static_cast<double>(n);
+			while(state.keepRunning()){
+				for(std::size_t i = 0; i < n; ++i){
+					out[i] = *(matrices[i & 63]*matrices[(i + 1) & 63]*matrices[(i + 2) & 63]*std::array<double,3>{0.3, -1.2, 0.7});
+				}
+				doNotOptimize(out.back());
+			}
+		});
+		registerBenchmark("BM_matrix_chain3_apply_evaluated/" + sizeName(n), [matrices, n](State &state){
+			std::vector<std::array<double,3>> out(n);
+			state.itemsPerIteration = static_cast<double>(n);
+			while(state.keepRunning()){
+				for(std::size_t i = 0; i < n; ++i){
+					out[i] = *(Matrix3<double>(matrices[i & 63]*matrices[(i + 1) & 63]*matrices[(i + 2) & 63])*std::array<double,3>{0.3, -1.2, 0.7});
+				}
+				doNotOptimize(out.back());
+			}
+		});
+		registerBenchmark("BM_matrix_chain3_apply_unchecked/" + sizeName(n), [matrices, n](State &state){
+			std::vector<std::array<double,3>> out(n);
+			state.itemsPerIteration = static_cast<double>(n);
+			while(state.keepRunning()){
+				for(std::size_t i = 0; i < n; ++i){
+					out[i] = (matrices[i & 63]*matrices[(i + 1) & 63]*matrices[(i + 2) & 63]).apply({0.3, -1.2, 0.7});
+				}
+				doNotOptimize(out.back());
+			}
+		});
+	}
+
+	registerBenchmark("BM_RotationAccumulator_composeAll/1K", [](State &state){
+		std::vector<quaternion<double>> chain(1 << 10, sampleQuaternion);
+		state.itemsPerIteration = static_cast<double>(chain.size());
+		while(state.keepRunning()){
+			RotationAccumulator<double> accumulator;
+			accumulator.composeAll(chain.data(), chain.size());
+			doNotOptimize(accumulator);
+		}
+	});
+
+	//Interpolation
+	addSingle("BM_quaternion_slerp", []{ auto a = sampleQuaternion, b = sampleQuaternion.inv(); doNotOptimize(a); doNotOptimize(b); return detail::slerpUnit(a, b, 0.3); });
+	addSingle("BM_quaternion_nlerp", []{ auto a = sampleQuaternion, b = sampleQuaternion.inv(); doNotOptimize(a); doNotOptimize(b); return detail::nlerpUnit(a, b, 0.3); });
+
+	//Resampling a track of 256 keys onto a dense grid, against a loop of scalar slerp. The small keys
+	//(3 degree steps) are nlerp segments at the default tolerance, the large ones (40 degrees) slerp.
+	{
+		const std::size_t keyCount = 256, n = std::size_t(1) << 16;
+		auto makeTrack = [keyCount](double stepAngle, std::vector<double> &keyTimes, QuaternionArray<double> &keys){
+			for(std::size_t k = 0; k < keyCount; ++k){
+				const double t = static_cast<double>(k);
+				keyTimes.push_back(t);
+				keys.push_back(*axisAngle<double>(0.8*std::cos(0.3*t), 0.8*std::sin(0.3*t), 0.6, 0.1 + stepAngle*t).convertToQuaternion());
+			}
+		};
+		std::vector<double> times(n);
+		for(std::size_t i = 0; i < n; ++i){
+			times[i] = static_cast<double>(keyCount - 1)*static_cast<double>(i)/static_cast<double>(n);
+		}
+		const std::vector<std::pair<std::string, double>> steps{{"small", 0.05}, {"large", 0.7}};
+		for(const auto &[stepName, stepAngle] : steps){
+			const std::vector<std::pair<std::string, batch::Interpolation>> methods{{"slerp", batch::Interpolation::slerp}, {"squad", batch::Interpolation::squad}};
+			for(const auto &[methodName, method] : methods){
+				registerBenchmark("BM_batch_resample_" + methodName + "_" + stepName + "/" + sizeName(n), [=](State &state){
+					std::vector<double> keyTimes;
+					QuaternionArray<double> keys, out(n);
+					makeTrack(stepAngle, keyTimes, keys);
+					state.itemsPerIteration = static_cast<double>(n);
+					while(state.keepRunning()){
+						batch::resample(keyTimes, keys, times, out, method);
+						doNotOptimize(out.w()[n - 1]);
+					}
+				});
+			}
+			registerBenchmark("BM_scalar_slerp_loop_" + stepName + "/" + sizeName(n), [=](State &state){
+				std::vector<double> keyTimes;
+				QuaternionArray<double> keys, out(n);
+				makeTrack(stepAngle, keyTimes, keys);
+				state.itemsPerIteration = static_cast<double>(n);
+				while(state.keepRunning()){
+					for(std::size_t i = 0; i < n; ++i){
+						const std::size_t k = static_cast<std::size_t>(times[i]);
+						out.set(i, *slerp(keys[k], keys[k + 1], times[i] - keyTimes[k]));
+					}
+					doNotOptimize(out.w()[n - 1]);
+				}
+			});
+		}
+	}
+
+	//Single vector rotation
+	const std::array<double,3> v{0.3, -1.2, 0.7};
+	addSingle("BM_rotateByQuaternion", [v]{ auto q = sampleQuaternion; auto r = v; doNotOptimize(q); doNotOptimize(r); return rotateByQuaternion(q, r); });
+	addSingle("BM_matrix_times_vector", [v]{ auto m = sampleMatrix; auto r = v; doNotOptimize(m); doNotOptimize(r); return m*r; });
+	const auto unit = UnitQuaternion<double>::fromQuaternion(sampleQuaternion).value();
+	const auto rotation = RotationMatrix<double>::fromMatrix(sampleMatrix).value();
+	addSingle("BM_UnitQuaternion_apply", [v, unit]{ auto q = unit; auto r = v; doNotOptimize(q); doNotOptimize(r); return q.apply(r); });
+	addSingle("BM_RotationMatrix_apply", [v, rotation]{ auto m = rotation; auto r = v; doNotOptimize(m); doNotOptimize(r); return m.apply(r); });
+
+	//Batch rotation
+	for(std::size_t n : {std::size_t(1) << 10, std::size_t(1) << 16, std::size_t(1) << 20}){
+		registerBenchmark("BM_Points_rotate/" + sizeName(n), [n](State &state){
+			Points<double> cloud = makeCloud(n);
+			state.itemsPerIteration = static_cast<double>(n);
+			while(state.keepRunning()){
+				Points<double> rotated = cloud.rotate(sampleQuaternion);
+				doNotOptimize(rotated.x()[n - 1]);
+			}
+		});
+		registerBenchmark("BM_Points_rotate_preallocated/" + sizeName(n), [n, rotation](State &state){
+			Points<double> cloud = makeCloud(n), rotated;
+			rotated.reserve(n);
+			state.itemsPerIteration = static_cast<double>(n);
+			while(state.keepRunning()){
+				cloud.rotate(rotation, rotated);
+				doNotOptimize(rotated.x()[n - 1]);
+			}
+		});
+		registerBenchmark("BM_Points_rotateInPlace/" + sizeName(n), [n, rotation](State &state){
+			Points<double> cloud = makeCloud(n);
+			state.itemsPerIteration = static_cast<double>(n);
+			while(state.keepRunning()){
+				cloud.rotateInPlace(rotation);
+				doNotOptimize(cloud.x()[n - 1]);
+			}
+		});
+	}
+	//Rotation about a pivot and translation: fused, against three passes (center, rotate, move)
+	{
+		const std::size_t n = std::size_t(1) << 20;
+		const std::array<double,3> pivot{0.5, 0.2, 0.1}, translation{1., -2., 3.};
+		registerBenchmark("BM_Points_rotateAbout_fused/" + sizeName(n), [n, rotation, pivot, translation](State &state){
+			Points<double> cloud = makeCloud(n);
+			state.itemsPerIteration = static_cast<double>(n);
+			while(state.keepRunning()){
+				cloud.rotateAbout(rotation, pivot, translation, cloud);
+				doNotOptimize(cloud.x()[n - 1]);
+			}
+		});
+		registerBenchmark("BM_Points_rotateAbout_threePasses/" + sizeName(n), [n, rotation, pivot, translation](State &state){
+			Points<double> cloud = makeCloud(n);
+			state.itemsPerIteration = static_cast<double>(n);
+			while(state.keepRunning()){
+				for(std::size_t i = 0; i < n; ++i){
+					cloud.x()[i] -= pivot[0]; cloud.y()[i] -= pivot[1]; cloud.z()[i] -= pivot[2];
+				}
+				cloud.rotateInPlace(rotation);
+				for(std::size_t i = 0; i < n; ++i){
+					cloud.x()[i] += pivot[0] + translation[0]; cloud.y()[i] += pivot[1] + translation[1]; cloud.z()[i] += pivot[2] + translation[2];
+				}
+				doNotOptimize(cloud.x()[n - 1]);
+			}
+		});
+	}
+	//Best-fit rigid transform between matched point sets: one pass accumulating the cross-covariance
+	{
+		const std::size_t n = std::size_t(1) << 20;
+		registerBenchmark("BM_fitRigidTransform/" + sizeName(n), [n, unit](State &state){
+			const Points<double> from = makeCloud(n);
+			const Points<double> to = from.transform(RigidTransform<double>(unit, {1., -2., 3.}));
+			state.itemsPerIteration = static_cast<double>(n);
+			while(state.keepRunning()){
+				const auto fit = fitRigidTransform(from, to);
+				doNotOptimize(fit);
+			}
+		});
+	}
+	//Mean of many rotations: one vectorized pass over an array, against one add per sample
+	{
+		const std::size_t n = std::size_t(1) << 20;
+		auto makeSamples = [n, unit]{
+			QuaternionArray<double> q;
+			for(std::size_t i = 0; i < n; ++i){
+				const double a = 1e-3*static_cast<double>(i % 1000);
+				q.push_back((unit*UnitQuaternion<double>::fromQuaternion({1., a, -a, 0.5*a}).value()).value());
+			}
+			return q;
+		};
+		registerBenchmark("BM_RotationAverage_array/" + sizeName(n), [n, makeSamples](State &state){
+			const QuaternionArray<double> q = makeSamples();
+			state.itemsPerIteration = static_cast<double>(n);
+			while(state.keepRunning()){
+				RotationAverage<double> average;
+				average.add(q);
+				doNotOptimize(average.mean());
+			}
+		});
+		registerBenchmark("BM_RotationAverage_single/" + sizeName(n), [n, makeSamples](State &state){
+			const QuaternionArray<double> q = makeSamples();
+			state.itemsPerIteration = static_cast<double>(n);
+			while(state.keepRunning()){
+				RotationAverage<double> average;
+				for(std::size_t i = 0; i < n; ++i){
+					average.add(UnitQuaternion<double>::fromQuaternion(q[i]).value());
+				}
+				doNotOptimize(average.mean());
+			}
+		});
+	}
+	//Nearest orientation in a library: the vantage-point tree, against a scan computing the angle of q^-1 p
+	for(std::size_t n : {std::size_t(100000), std::size_t(1) << 20}){
+		auto makeLibrary = [n]{
+			std::vector<UnitQuaternion<double>> library;
+			for(std::size_t i = 0; i < n; ++i){
+				const double t = static_cast<double>(i);
+				library.push_back(UnitQuaternion<double>::fromQuaternion({std::sin(1.3*t + 0.2), std::cos(2.1*t), std::sin(0.7*t + 1.), std::cos(3.3*t + 0.5)}).value());
+			}
+			return library;
+		};
+		const std::string size = n == 100000 ? "100k" : sizeName(n);
+		registerBenchmark("BM_OrientationIndex_nearest/" + size, [makeLibrary](State &state){
+			const OrientationIndex<double> index(makeLibrary());
+			std::size_t i = 0;
+			while(state.keepRunning()){
+				const double t = static_cast<double>(i++ % 1000);
+				const auto q = UnitQuaternion<double>::fromQuaternion({std::cos(0.9*t), std::sin(1.7*t + 0.3), std::cos(0.4*t + 2.), std::sin(2.9*t)}).value();
+				doNotOptimize(index.nearest(q));
+			}
+		});
+		registerBenchmark("BM_OrientationIndex_bruteForce/" + size, [makeLibrary](State &state){
+			const std::vector<UnitQuaternion<double>> library = makeLibrary();
+			std::size_t i = 0;
+			while(state.keepRunning()){
+				const double t = static_cast<double>(i++ % 1000);
+				const auto q = UnitQuaternion<double>::fromQuaternion({std::cos(0.9*t), std::sin(1.7*t + 0.3), std::cos(0.4*t + 2.), std::sin(2.9*t)}).value();
+				double best = 4;
+				std::size_t bestIndex = 0;
+				for(std::size_t j = 0; j < library.size(); ++j){
+					const quaternion<double> d = (q.inv()*library[j]).value();
+					const double angle = 2*std::atan2(std::sqrt(d.x()*d.x() + d.y()*d.y() + d.z()*d.z()), std::abs(d.w()));
+					if(angle < best){
+						best = angle;
+						bestIndex = j;
+					}
+				}
+				doNotOptimize(bestIndex);
+			}
+		});
+	}
+	//Uniform random rotations: Philox and Shoemake in one vectorized loop, against random axes and angles converted
+	//one at a time (which is not uniform on SO(3) either)
+	{
+		const std::size_t n = std::size_t(1) << 20;
+		registerBenchmark("BM_uniformRotations_quaternion/" + sizeName(n), [n](State &state){
+			QuaternionArray<double> q(n);
+			std::uint64_t first = 0;
+			state.itemsPerIteration = static_cast<double>(n);
+			while(state.keepRunning()){
+				batch::uniformRotations(42, first, n, q);
+				first += n;
+				doNotOptimize(q.w()[n - 1]);
+			}
+		});
+		registerBenchmark("BM_uniformRotations_quaternion_float/" + sizeName(n), [n](State &state){
+			QuaternionArray<float> q(n);
+			std::uint64_t first = 0;
+			state.itemsPerIteration = static_cast<double>(n);
+			while(state.keepRunning()){
+				batch::uniformRotations(42, first, n, q);
+				first += n;
+				doNotOptimize(q.w()[n - 1]);
+			}
+		});
+		registerBenchmark("BM_uniformRotations_matrix/" + sizeName(n), [n](State &state){
+			MatrixArray<double> M(n);
+			std::uint64_t first = 0;
+			state.itemsPerIteration = static_cast<double>(n);
+			while(state.keepRunning()){
+				batch::uniformRotations(42, first, n, M);
+				first += n;
+				doNotOptimize(M(2, 2)[n - 1]);
+			}
+		});
+		registerBenchmark("BM_randomAxisAngle_convertToQuaternion/" + sizeName(n), [n](State &state){
+			QuaternionArray<double> q(n);
+			std::mt19937_64 random(42);
+			std::uniform_real_distribution<double> uniform(-1., 1.);
+			state.itemsPerIteration = static_cast<double>(n);
+			while(state.keepRunning()){
+				for(std::size_t i = 0; i < n; ++i){
+					const axisAngle<double> a({uniform(random), uniform(random), uniform(random)}, 180.*(uniform(random) + 1.));
+					q.set(i, a.convertToQuaternion().value_or(quaternion<double>()));
+				}
+				doNotOptimize(q.w()[n - 1]);
+			}
+		});
+	}
+	registerBenchmark("BM_Points_rotateInPlace_parallel/16M", [rotation](State &state){
+		const std::size_t n = std::size_t(1) << 24;
+		static ThreadPool pool;
+		Points<double> cloud = makeCloud(n);
+		state.itemsPerIteration = static_cast<double>(n);
+		while(state.keepRunning()){
+			cloud.rotateInPlace(rotation, {&pool, std::size_t(1) << 16});
+			doNotOptimize(cloud.x()[n - 1]);
+		}
+	});
+
+	//A different rotation per point, against rotateByQuaternion point by point; blends of 4 out of a palette of 64
+	{
+		const std::size_t n = std::size_t(1) << 16, perPoint = 4;
+		QuaternionArray<double> q;
+		MatrixArray<double> palette;
+		std::vector<std::uint32_t> bone(n*perPoint);
+		std::vector<double> weight(n*perPoint, 1./perPoint);
+		for(std::size_t i = 0; i < n; ++i){
+			q.push_back(axisAngle<double>({0.6, 0., 0.8}, 1e-4*static_cast<double>(i + 1)).convertToQuaternion().value());
+		}
+		for(std::size_t b = 0; b < 64; ++b){
+			palette.push_back(q[1000*b].convertToMatrix());
+		}
+		for(std::size_t k = 0; k < n*perPoint; ++k){
+			bone[k] = static_cast<std::uint32_t>((k*37) % 64);
+		}
+		registerBenchmark("BM_batch_rotate_perPoint/" + sizeName(n), [n, q](State &state){
+			Points<double> cloud = makeCloud(n);
+			ValidityMask valid;
+			state.itemsPerIteration = static_cast<double>(n);
+			while(state.keepRunning()){
+				batch::rotate(q, cloud, cloud, valid);
+				doNotOptimize(cloud.x()[n - 1]);
+			}
+		});
+		registerBenchmark("BM_rotateByQuaternion_perPoint_loop/" + sizeName(n), [n, q](State &state){
+			Points<double> cloud = makeCloud(n);
+			state.itemsPerIteration = static_cast<double>(n);
+			while(state.keepRunning()){
+				for(std::size_t i = 0; i < n; ++i){
+					const std::array<double,3> r = *rotateByQuaternion(q[i], cloud[i]);
+					cloud.x()[i] = r[0]; cloud.y()[i] = r[1]; cloud.z()[i] = r[2];
+				}
+				doNotOptimize(cloud.x()[n - 1]);
+			}
+		});
+		registerBenchmark("BM_batch_blend_4/" + sizeName(n), [n, palette, bone, weight](State &state){
+			Points<double> cloud = makeCloud(n);
+			state.itemsPerIteration = static_cast<double>(n);
+			while(state.keepRunning()){
+				batch::blend(palette, bone, weight, perPoint, cloud, cloud);
+				doNotOptimize(cloud.x()[n - 1]);
+			}
+		});
+	}
+
+	//A rotation per point, out of 36 yaw bins: looked up in a table, against converted point by point
+	{
+		const std::size_t n = std::size_t(1) << 16, bins = 36;
+		constexpr double pi = 3.14159265358979323846;
+		std::vector<std::uint32_t> index(n);
+		for(std::size_t i = 0; i < n; ++i){
+			index[i] = static_cast<std::uint32_t>((i*7919) % bins);
+		}
+		registerBenchmark("BM_RotationTable_apply/" + sizeName(n), [n, index](State &state){
+			const RotationTable<double> yaw = RotationTable<double>::aboutAxis({0., 0., 1.}, bins).value();
+			Points<double> cloud = makeCloud(n);
+			state.itemsPerIteration = static_cast<double>(n);
+			while(state.keepRunning()){
+				yaw.apply(cloud, index, cloud);
+				doNotOptimize(cloud.x()[n - 1]);
+			}
+		});
+		registerBenchmark("BM_axisAngle_convertToMatrix_perPoint/" + sizeName(n), [n, index](State &state){
+			Points<double> cloud = makeCloud(n);
+			state.itemsPerIteration = static_cast<double>(n);
+			while(state.keepRunning()){
+				for(std::size_t i = 0; i < n; ++i){
+					const Matrix3<double> M = *axisAngle<double>({0., 0., 1.}, 2*pi*index[i]/bins).convertToMatrix();
+					const std::array<double,3> r = *(M*cloud[i]);
+					cloud.x()[i] = r[0]; cloud.y()[i] = r[1]; cloud.z()[i] = r[2];
+				}
+				doNotOptimize(cloud.x()[n - 1]);
+			}
+		});
+	}
+
+	//Kernels, per instruction set
+	for(simd::Isa isa : {simd::Isa::scalar, simd::Isa::sse2, simd::Isa::avx2, simd::Isa::avx512}){
+		if(!simd::isSupported(isa)){
+			continue;
+		}
+		const std::string isaName[] = {"scalar", "sse2", "avx2", "avx512"};
+		const std::size_t n = std::size_t(1) << 16;
+		registerBenchmark("BM_rotateSoA_double_" + isaName[static_cast<int>(isa)] + "/" + sizeName(n), [isa, n](State &state){
+			Points<double> cloud = makeCloud(n);
+			state.itemsPerIteration = static_cast<double>(n);
+			while(state.keepRunning()){
+				simd::rotateSoA(isa, sampleMatrix, cloud.x(), cloud.y(), cloud.z(), cloud.x(), cloud.y(), cloud.z(), n);
+				doNotOptimize(cloud.x()[n - 1]);
+			}
+		});
+		registerBenchmark("BM_rotateSoA_float_" + isaName[static_cast<int>(isa)] + "/" + sizeName(n), [isa, n](State &state){
+			Points<double> cloudDouble = makeCloud(n);
+			std::vector<float> x(cloudDouble.x(), cloudDouble.x() + n), y(cloudDouble.y(), cloudDouble.y() + n), z(cloudDouble.z(), cloudDouble.z() + n);
+			Matrix3<float> m;
+			std::copy(sampleMatrix.cbegin(), sampleMatrix.cend(), m.begin());
+			state.itemsPerIteration = static_cast<double>(n);
+			while(state.keepRunning()){
+				simd::rotateSoA(isa, m, x.data(), y.data(), z.data(), x.data(), y.data(), z.data(), n);
+				doNotOptimize(x[n - 1]);
+			}
+		});
+	}
+}
+
+int main(int argc, char **argv) {
+	std::string filter, format = "console", outFile;
+	double minTime = 0.2;
+	for(int i = 1; i < argc; ++i){
+		std::string arg = argv[i];
+		auto value = [&](const std::string &flag){ return arg.substr(flag.size()); };
+		if(arg.rfind("--benchmark_filter=", 0) == 0){
+			filter = value("--benchmark_filter=");
+		}
+		else if(arg.rfind("--benchmark_min_time=", 0) == 0){
+			minTime = std::stod(value("--benchmark_min_time="));
+		}
+		else if(arg.rfind("--benchmark_format=", 0) == 0){
+			format = value("--benchmark_format=");
+		}
+		else if(arg.rfind("--benchmark_out=", 0) == 0){
+			outFile = value("--benchmark_out=");
+		}
+		else{
+			std::cerr << "unknown argument " << arg << "\n";
+			return 1;
+		}
+	}
+
+	registerBenchmarks();
+	std::vector<Result> results;
+	for(const Benchmark &benchmark : registry()){
+		if(benchmark.name.find(filter) == std::string::npos){
+			continue;
+		}
+		results.push_back(measure(benchmark, minTime));
+		if(format == "console"){
+			printConsole(results.back());
+		}
+	}
+	if(format == "json"){
+		std::cout << toJson(results);
+	}
+	if(!outFile.empty()){
+		std::ofstream(outFile) << toJson(results);
+	}
+	return 0;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <array>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+namespace detail
+{
+	template<typename T>
+	using Matrix4 = std::array<std::array<T,4>,4>;
+
+	//Eigen decomposition of a symmetric 4x4 matrix by cyclic Jacobi rotations: a = V diag(values) V^T, with the
+	//eigenvalues in decreasing order and eigenvector k in column k of V (vectors[i][k]). Accurate to rounding,
+	//also for close eigenvalues; a handful of sweeps converge to full precision.
+	template<typename T>
+	void symmetricEigen4(Matrix4<T> a, std::array<T,4> &values, Matrix4<T> &vectors) {
+		Matrix4<T> v{};
+		for(int i = 0; i < 4; ++i){
+			v[i][i] = 1;
+		}
+		for(int sweep = 0; sweep < 50; ++sweep){
+			T off = 0, diagonal = 0;
+			for(int p = 0; p < 4; ++p){
+				diagonal += a[p][p]*a[p][p];
+				for(int q = p + 1; q < 4; ++q){
+					off += a[p][q]*a[p][q];
+				}
+			}
+			if(!(off > std::numeric_limits<T>::min() + std::numeric_limits<T>::epsilon()*std::numeric_limits<T>::epsilon()*diagonal)){
+				break; //also for NaN
+			}
+			for(int p = 0; p < 3; ++p){
+				for(int q = p + 1; q < 4; ++q){
+					if(a[p][q] == 0){
+						continue;
+					}
+					//the rotation by angle phi, tan phi = t, that zeroes a[p][q]
+					const T theta = (a[q][q] - a[p][p])/(2*a[p][q]);
+					const T t = (theta >= 0 ? T(1) : T(-1))/(std::abs(theta) + std::sqrt(theta*theta + 1));
+					const T c = 1/std::sqrt(t*t + 1), s = t*c, tau = s/(1 + c), h = t*a[p][q];
+					a[p][p] -= h;
+					a[q][q] += h;
+					a[p][q] = a[q][p] = 0;
+					for(int r = 0; r < 4; ++r){
+						if(r != p and r != q){
+							const T g = a[r][p], k = a[r][q];
+							a[r][p] = a[p][r] = g - s*(k + g*tau);
+							a[r][q] = a[q][r] = k + s*(g - k*tau);
+						}
+						const T g = v[r][p], k = v[r][q];
+						v[r][p] = g - s*(k + g*tau);
+						v[r][q] = k + s*(g - k*tau);
+					}
+				}
+			}
+		}
+		std::array<int,4> order{0, 1, 2, 3};
+		std::sort(order.begin(), order.end(), [&a](int i, int j){ return a[i][i] > a[j][j]; });
+		for(int k = 0; k < 4; ++k){
+			values[k] = a[order[k]][order[k]];
+			for(int i = 0; i < 4; ++i){
+				vectors[i][k] = v[i][order[k]];
+			}
+		}
+	}
+}
@@ -0,0 +1,181 @@
+#pragma once
+#include <cmath>
+#include <type_traits>
+
+//Branch-free sin/cos/atan2 for float and double, written with selects instead of branches so that
+//loops calling them vectorize (the compiler cannot vectorize calls to std::sin, std::cos, std::atan2).
+//Polynomials and range reduction follow Cephes.
+//Measured maximum absolute error against the std:: functions (checked in testBatchConversion.hpp):
+//  sincos: double 2.3e-16 for |x| <= 1e7, float 9.3e-8 for |x| <= 8192 (range reduction loses accuracy beyond)
+//  atan2:  double 4.5e-16, float 2.8e-7 (about 2 ULP of pi)
+namespace fastmath
+{
+	namespace detail
+	{
+		//Round to nearest for |v| < 2^51 (2^22 for float), with an add and a subtract: vectorizes without SSE4.1
+		template<typename T>
+		inline T roundNearest(T v) {
+			constexpr T magic = std::is_same_v<T, float> ? T(12582912.f) : T(6755399441055744.); //1.5 * 2^mantissa bits
+			return (v + magic) - magic;
+		}
+	}
+
+	namespace detail
+	{
+		//x = j pi/2 + r, with |r| <= pi/4 and j a whole number; pi/2 is split in three parts, so that j*PIO2_1
+		//is exact for the arguments covered
+		template<typename T>
+		inline T reduceQuarterTurns(T x, T &j) {
+			constexpr bool isFloat = std::is_same_v<T, float>;
+			constexpr T PIO2_1 = isFloat ? T(1.5703125f) : T(1.57079625129699707031);
+			constexpr T PIO2_2 = isFloat ? T(4.837512969970703125e-4f) : T(7.54978941586159635335e-8);
+			constexpr T PIO2_3 = isFloat ? T(7.54978995489188216e-8f) : T(5.39030285815811905290e-15);
+			constexpr T TWO_OVER_PI = T(0.636619772367581343076);
+			j = roundNearest(x*TWO_OVER_PI);
+			return ((x - j*PIO2_1) - j*PIO2_2) - j*PIO2_3;
+		}
+
+		//sin and cos of |r| <= pi/4. The polynomials are evaluated in Estrin's scheme (powers of z in parallel)
+		//rather than Horner's, which shortens the chain of dependent multiply-adds.
+		template<typename T>
+		inline void sincosPolynomials(T r, T &sr, T &cr) {
+			const T z = r*r, z2 = z*z;
+			if constexpr(std::is_same_v<T, float>){
+				sr = r + r*z*((T(-1.6666654611e-1f) + z*T(8.3321608736e-3f)) + z2*T(-1.9515295891e-4f));
+				cr = T(1) - T(0.5f)*z + z2*((T(4.166664568298827e-2f) + z*T(-1.388731625493765e-3f)) + z2*T(2.443315711809948e-5f));
+			}
+			else{
+				const T z4 = z2*z2;
+				sr = r + r*z*((T(-1.66666666666666307295e-1) + z*T(8.33333333332211858878e-3))
+				     + z2*(T(-1.98412698295895385996e-4) + z*T(2.75573136213857245213e-6))
+				     + z4*(T(-2.50507477628578072866e-8) + z*T(1.58962301576546568060e-10)));
+				cr = T(1) - T(0.5)*z + z2*((T(4.16666666666665929218e-2) + z*T(-1.38888888888730564116e-3))
+				     + z2*(T(2.48015872888517045348e-5) + z*T(-2.75573141792967388112e-7))
+				     + z4*(T(2.08757008419747316778e-9) + z*T(-1.13585365213876817300e-11)));
+			}
+		}
+	}
+
+	//s = sin(x), c = cos(x)
+	template<typename T>
+	inline void sincos(T x, T &s, T &c) {
+		static_assert(std::is_floating_point_v<T>, "sincos needs a floating point type");
+		T j; //quadrant
+		T sr, cr;
+		detail::sincosPolynomials(detail::reduceQuarterTurns(x, j), sr, cr);
+		//quadrant q = j mod 4, computed in floating point: floor(j/4) == round((j - 1.5)/4)
+		const T q = j - T(4)*detail::roundNearest((j - T(1.5))*T(0.25));
+		const bool swap = (q == T(1)) or (q == T(3));
+		const T sinBase = swap ? cr : sr;
+		const T cosBase = swap ? sr : cr;
+		s = (q >= T(2)) ? -sinBase : sinBase;
+		c = (q == T(1) or q == T(2)) ? -cosBase : cosBase;
+	}
+
+	template<typename T>
+	inline T sin(T x) {
+		T s, c;
+		sincos(x, s, c);
+		return s;
+	}
+
+	template<typename T>
+	inline T cos(T x) {
+		T s, c;
+		sincos(x, s, c);
+		return c;
+	}
+
+	//atan2(y, x), in [-pi, pi]. atan2(0, 0) = 0.
+	template<typename T>
+	inline T atan2(T y, T x) {
+		static_assert(std::is_floating_point_v<T>, "atan2 needs a floating point type");
+		constexpr T PI = T(3.14159265358979323846);
+		constexpr T TAN_PI_8 = T(0.414213562373095048802);
+		const T ax = std::abs(x), ay = std::abs(y);
+		const bool steep = ay > ax;
+		const T big = steep ? ay : ax;
+		const T small = steep ? ax : ay;
+		const T t = small / (big > T(0) ? big : T(1)); //in [0, 1]; divisions are unconditional so the loop has no branch
+		//atan(t) = pi/4 + atan((t - 1)/(t + 1)) brings t below tan(pi/8)
+		const bool shift = t > TAN_PI_8;
+		const T shifted = (t - T(1)) / (t + T(1));
+		const T u = shift ? shifted : t;
+		const T z = u*u;
+		T a;
+		if constexpr(std::is_same_v<T, float>){
+			a = u + u*z*(((T(8.05374449538e-2f)*z + T(-1.38776856032e-1f))*z + T(1.99777106478e-1f))*z + T(-3.33329491539e-1f));
+		}
+		else{
+			const T p = (((T(-8.750608600031904122785e-1)*z + T(-1.615753718733365076637e1))*z
+			            + T(-7.500855792314704667340e1))*z + T(-1.228866684490136173410e2))*z + T(-6.485021904942025371773e1);
+			const T qq = ((((z + T(2.485846490142306297962e1))*z + T(1.650270098316988542046e2))*z
+			             + T(4.328810604912902668951e2))*z + T(4.853903996359136964868e2))*z + T(1.945506571482613964425e2);
+			a = u + u*z*p/qq;
+		}
+		a = shift ? a + PI/4 : a;
+		a = steep ? PI/2 - a : a;
+		a = x < T(0) ? PI - a : a;
+		return std::copysign(a, y); //a >= 0
+	}
+}
+
+//Trigonometry policies of the scalar conversions, selected by their template parameter:
+//  a.convertToMatrix()            StdTrig: the std:: functions
+//  a.convertToMatrix<FastTrig>()  FastTrig: the polynomials above, and Taylor series for small angles
+//Below smallAngle (double 0.03, float 0.2) the Taylor series are exact to rounding and skip the range
+//reduction and the quadrant selects. Beyond largeAngle (double 1e7, float 8192), and for NaN and infinities,
+//sincos falls back to std::sin and std::cos. Maximum absolute error of FastTrig against std:: (testFastTrig.hpp):
+//  sincos: double 2.3e-16, float 9.3e-8;  atan2: double 4.5e-16, float 2.8e-7
+struct StdTrig{
+	template<typename T>
+	static void sincos(T x, T &s, T &c) {
+		s = std::sin(x);
+		c = std::cos(x);
+	}
+	template<typename T>
+	static T atan2(T y, T x) {
+		return std::atan2(y, x);
+	}
+};
+
+struct FastTrig{
+	template<typename T>
+	static constexpr T smallAngle = std::is_same_v<T, float> ? T(0.2f) : T(0.03);
+	//the range where the reduction is accurate, and the quadrant converts to an integer
+	template<typename T>
+	static constexpr T largeAngle = std::is_same_v<T, float> ? T(8192.f) : T(1e7);
+
+	//The quadrant is taken as an integer: one well predicted branch, shorter than fastmath::sincos's selects
+	template<typename T>
+	static void sincos(T x, T &s, T &c) {
+		if(std::abs(x) < smallAngle<T>){
+			const T z = x*x; //the first omitted terms are below 1/2 ULP
+			s = x + x*z*(T(-1)/6 + z*(T(1)/120 + z*(T(-1)/5040)));
+			c = T(1) + z*(T(-0.5) + z*(T(1)/24 + z*(T(-1)/720 + z*(T(1)/40320))));
+			return;
+		}
+		if(!(std::abs(x) <= largeAngle<T>)){ //also NaN: converting its quadrant to an integer would be undefined
+			s = std::sin(x);
+			c = std::cos(x);
+			return;
+		}
+		T j, sr, cr;
+		fastmath::detail::sincosPolynomials(fastmath::detail::reduceQuarterTurns(x, j), sr, cr);
+		switch(static_cast<long long>(j) & 3){
+			case 0: s = sr; c = cr; break;
+			case 1: s = cr; c = -sr; break;
+			case 2: s = -sr; c = -cr; break;
+			default: s = -cr; c = sr; break;
+		}
+	}
+
+	template<typename T>
+	static T atan2(T y, T x) {
+		if(x > T(0) and std::abs(y) < smallAngle<T>*x){
+			const T t = y/x, z = t*t;
+			return t + t*z*(T(-1)/3 + z*(T(1)/5 + z*(T(-1)/7 + z*(T(1)/9))));
+		}
+		return fastmath::atan2(y, x);
+	}
+};
@@ -0,0 +1,161 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <optional>
+#include "matrix.hpp"
+#include "quaternion.hpp"
+#include "points.hpp"
+#include "parallel.hpp"
+#include "rigidTransform.hpp"
+#include "batchConversion.hpp"
+#include "eigen4.hpp"
+
+//Best-fit rotation between two point sets, point i of one matched to point i of the other (Kabsch, Wahba).
+//One pass over the points accumulates the 3x3 cross-covariance, in lanes of partial sums that vectorize (and
+//in chunks on a ThreadPool); Horn's method then takes the rotation as the top eigenvector of a 4x4 matrix.
+//float points are accumulated in double.
+namespace detail
+{
+	//Sums over the pairs (a, b), shifted by a reference pair (a0, b0) so that clouds far from the origin do not cancel
+	template<typename S>
+	struct PairSums{
+		std::array<S,3> a{}, b{};  //sum of a - a0, of b - b0
+		std::array<S,9> ab{};      //row major: sum of (a - a0)_i (b - b0)_j
+		PairSums& operator+=(const PairSums &other) {
+			for(int i = 0; i < 3; ++i){
+				a[i] += other.a[i];
+				b[i] += other.b[i];
+			}
+			for(int k = 0; k < 9; ++k){
+				ab[k] += other.ab[k];
+			}
+			return *this;
+		}
+	};
+
+	template<typename S, typename T>
+	PairSums<S> sumPairs(const T *ax, const T *ay, const T *az, const T *bx, const T *by, const T *bz, std::size_t n,
+	                     const std::array<T,3> &a0, const std::array<T,3> &b0) {
+		PairSums<S> sums;
+		batch::detail::run([&]{
+			constexpr std::size_t lanes = 32/sizeof(S); //one AVX2 register per sum
+			S sa[3][lanes] = {}, sb[3][lanes] = {}, sab[9][lanes] = {};
+			auto add = [&](std::size_t i, std::size_t l){
+				const S x = S(ax[i]) - S(a0[0]), y = S(ay[i]) - S(a0[1]), z = S(az[i]) - S(a0[2]);
+				const S u = S(bx[i]) - S(b0[0]), v = S(by[i]) - S(b0[1]), w = S(bz[i]) - S(b0[2]);
+				sa[0][l] += x; sa[1][l] += y; sa[2][l] += z;
+				sb[0][l] += u; sb[1][l] += v; sb[2][l] += w;
+				sab[0][l] += x*u; sab[1][l] += x*v; sab[2][l] += x*w;
+				sab[3][l] += y*u; sab[4][l] += y*v; sab[5][l] += y*w;
+				sab[6][l] += z*u; sab[7][l] += z*v; sab[8][l] += z*w;
+			};
+			std::size_t i = 0;
+			for(; i + lanes <= n; i += lanes){
+				for(std::size_t l = 0; l < lanes; ++l){
+					add(i + l, l);
+				}
+			}
+			for(; i < n; ++i){
+				add(i, 0);
+			}
+			for(std::size_t l = 0; l < lanes; ++l){
+				for(int k = 0; k < 3; ++k){
+					sums.a[k] += sa[k][l];
+					sums.b[k] += sb[k][l];
+				}
+				for(int k = 0; k < 9; ++k){
+					sums.ab[k] += sab[k][l];
+				}
+			}
+		});
+		return sums;
+	}
+
+	//Sums over all pairs, shifted by the first pair (in chunks on options.pool)
+	template<typename S, typename T>
+	PairSums<S> sumPairs(const Points<T> &from, const Points<T> &to, const ParallelOptions &options) {
+		const std::array<T,3> a0 = from[0], b0 = to[0];
+		return parallelReduce<PairSums<S>>(from.size(), options, [&](std::size_t begin, std::size_t end){
+			return sumPairs<S>(from.x() + begin, from.y() + begin, from.z() + begin,
+			                   to.x() + begin, to.y() + begin, to.z() + begin, end - begin, a0, b0);
+		});
+	}
+
+	//Horn's method: the rotation R maximizing sum b^T R a, for M = sum a b^T (row major), is the eigenvector of the
+	//largest eigenvalue of a symmetric 4x4 matrix. Fails if that eigenvalue is not separated (e.g. all points on a line).
+	template<typename S>
+	std::optional<quaternion<S>> hornRotation(const std::array<S,9> &M) {
+		const S xx = M[0], xy = M[1], xz = M[2], yx = M[3], yy = M[4], yz = M[5], zx = M[6], zy = M[7], zz = M[8];
+		const Matrix4<S> N{{{xx + yy + zz, yz - zy,       zx - xz,       xy - yx},
+		                    {yz - zy,      xx - yy - zz,  xy + yx,       zx + xz},
+		                    {zx - xz,      xy + yx,       -xx + yy - zz, yz + zy},
+		                    {xy - yx,      zx + xz,       yz + zy,       -xx - yy + zz}}};
+		std::array<S,4> values;
+		Matrix4<S> vectors;
+		symmetricEigen4(N, values, vectors);
+		const S scale = std::max(std::abs(values[0]), std::abs(values[3]));
+		if(!(values[0] - values[1] > 1024*std::numeric_limits<S>::epsilon()*scale)){ //also false for NaN
+			return std::nullopt;
+		}
+		const S sign = vectors[0][0] < 0 ? S(-1) : S(1); //w >= 0
+		return quaternion<S>(sign*vectors[0][0], sign*vectors[1][0], sign*vectors[2][0], sign*vectors[3][0]);
+	}
+}
+
+//Rotation R and translation t minimizing sum |R from[i] + t - to[i]|^2 (Kabsch). Fails if the sets differ in size or
+//do not determine the rotation (fewer than 3 points, or all on a line).
+template<typename T>
+std::optional<RigidTransform<T>> fitRigidTransform(const Points<T> &from, const Points<T> &to, const ParallelOptions &options = {}) {
+	using S = decltype(T() + 0.);
+	const std::size_t n = from.size();
+	if(to.size() != n or n == 0){
+		return std::nullopt;
+	}
+	const detail::PairSums<S> sums = detail::sumPairs<S>(from, to, options);
+	const S count = static_cast<S>(n);
+	std::array<S,9> covariance; //centered: sum (a - ca)(b - cb)^T
+	for(int i = 0; i < 3; ++i){
+		for(int j = 0; j < 3; ++j){
+			covariance[3*i + j] = sums.ab[3*i + j] - sums.a[i]*sums.b[j]/count;
+		}
+	}
+	const auto q = detail::hornRotation(covariance);
+	if(!q){
+		return std::nullopt;
+	}
+	const UnitQuaternion<T> rotation = UnitQuaternion<T>::fromQuaternion({T(q->w()), T(q->x()), T(q->y()), T(q->z())}).value();
+	const std::array<T,3> a0 = from[0], b0 = to[0];
+	//t = cb - R ca, with the centroids relative to the reference pair: cb - R ca = (b0 - R a0) + (sb - R sa)/n
+	const std::array<T,3> ra0 = rotation.apply(a0);
+	const std::array<T,3> ra = rotation.apply({T(sums.a[0]/count), T(sums.a[1]/count), T(sums.a[2]/count)});
+	return RigidTransform<T>(rotation, {(b0[0] - ra0[0]) + (T(sums.b[0]/count) - ra[0]),
+	                                    (b0[1] - ra0[1]) + (T(sums.b[1]/count) - ra[1]),
+	                                    (b0[2] - ra0[2]) + (T(sums.b[2]/count) - ra[2])});
+}
+
+//Rotation R minimizing sum |R from[i] - to[i]|^2, about the origin (Wahba's problem, e.g. for directions).
+//Fails if the sets differ in size or do not determine the rotation.
+template<typename T>
+std::optional<UnitQuaternion<T>> fitRotation(const Points<T> &from, const Points<T> &to, const ParallelOptions &options = {}) {
+	using S = decltype(T() + 0.);
+	const std::size_t n = from.size();
+	if(to.size() != n or n == 0){
+		return std::nullopt;
+	}
+	const detail::PairSums<S> sums = detail::sumPairs<S>(from, to, options);
+	const std::array<T,3> a0 = from[0], b0 = to[0];
+	std::array<S,9> M; //sum a b^T, from the shifted sums
+	for(int i = 0; i < 3; ++i){
+		for(int j = 0; j < 3; ++j){
+			M[3*i + j] = sums.ab[3*i + j] + S(a0[i])*sums.b[j] + sums.a[i]*S(b0[j]) + static_cast<S>(n)*S(a0[i])*S(b0[j]);
+		}
+	}
+	const auto q = detail::hornRotation(M);
+	if(!q){
+		return std::nullopt;
+	}
+	return UnitQuaternion<T>::fromQuaternion({T(q->w()), T(q->x()), T(q->y()), T(q->z())}).value();
+}
@@ -0,0 +1,275 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include "quaternion.hpp"
+#include "precision.hpp"
+#include "rotationArrays.hpp"
+#include "fastMath.hpp"
+#include "batchConversion.hpp"
+
+//Interpolation between rotations: nlerp, slerp and squad on quaternions, and resampling of keyframe tracks.
+//nlerp and slerp take the shorter of the two arcs (q and -q are the same rotation); squad does not flip
+//(as in Shoemake), so its keys should be on one hemisphere (batch::resample takes care of it).
+namespace detail
+{
+	template<typename T>
+	inline T dot(const quaternion<T> &a, const quaternion<T> &b) {
+		return a.w()*b.w() + a.x()*b.x() + a.y()*b.y() + a.z()*b.z();
+	}
+
+	template<typename T>
+	inline quaternion<T> shorterArc(const quaternion<T> &a, const quaternion<T> &b) { //b or -b, whichever is closer to a
+		return dot(a, b) < 0 ? quaternion<T>{-b.w(), -b.x(), -b.y(), -b.z()} : b;
+	}
+
+	//Great arc from unit quaternion a to b: q(t) = a cos(t angle) + c sin(t angle), with c the unit quaternion
+	//orthogonal to a in the plane of a and b. The angle comes from atan2, which is accurate for small arcs
+	//(unlike acos of the dot product).
+	template<typename T>
+	struct Arc{
+		quaternion<T> a, c;
+		T angle = 0;
+
+		Arc(const quaternion<T> &from, const quaternion<T> &to): a{from} {
+			const T d = dot(from, to);
+			T cw = to.w() - d*from.w(), cx = to.x() - d*from.x(), cy = to.y() - d*from.y(), cz = to.z() - d*from.z();
+			const T cNorm = std::sqrt(cw*cw + cx*cx + cy*cy + cz*cz);
+			if(cNorm > 0){
+				c = {cw/cNorm, cx/cNorm, cy/cNorm, cz/cNorm};
+				const T dw = to.w() - from.w(), dx = to.x() - from.x(), dy = to.y() - from.y(), dz = to.z() - from.z();
+				const T sw = to.w() + from.w(), sx = to.x() + from.x(), sy = to.y() + from.y(), sz = to.z() + from.z();
+				angle = 2*std::atan2(std::sqrt(dw*dw + dx*dx + dy*dy + dz*dz), std::sqrt(sw*sw + sx*sx + sy*sy + sz*sz));
+			}
+		}
+
+		quaternion<T> at(T t) const {
+			const T cosine = std::cos(t*angle), sine = std::sin(t*angle);
+			return {a.w()*cosine + c.w()*sine, a.x()*cosine + c.x()*sine, a.y()*cosine + c.y()*sine, a.z()*cosine + c.z()*sine};
+		}
+	};
+
+	template<typename T>
+	quaternion<T> nlerpUnit(const quaternion<T> &a, const quaternion<T> &b, T t) {
+		const quaternion<T> to = shorterArc(a, b);
+		const T w = (1 - t)*a.w() + t*to.w(), x = (1 - t)*a.x() + t*to.x(), y = (1 - t)*a.y() + t*to.y(), z = (1 - t)*a.z() + t*to.z();
+		const T inverseNorm = 1/std::sqrt(w*w + x*x + y*y + z*z); //at least 1/sqrt(2): a and b are on one hemisphere
+		return {w*inverseNorm, x*inverseNorm, y*inverseNorm, z*inverseNorm};
+	}
+
+	template<typename T>
+	quaternion<T> slerpUnit(const quaternion<T> &a, const quaternion<T> &b, T t) {
+		return Arc<T>(a, shorterArc(a, b)).at(t);
+	}
+
+	template<typename T>
+	quaternion<T> squadUnit(const quaternion<T> &q0, const quaternion<T> &q1, const quaternion<T> &s0, const quaternion<T> &s1, T t) {
+		return Arc<T>(Arc<T>(q0, q1).at(t), Arc<T>(s0, s1).at(t)).at(2*t*(1 - t));
+	}
+
+	//log and exp of unit and pure quaternions
+	template<typename T>
+	quaternion<T> quaternionLog(const quaternion<T> &q) {
+		const T v = std::sqrt(q.x()*q.x() + q.y()*q.y() + q.z()*q.z());
+		const T scale = v > 0 ? std::atan2(v, q.w())/v : T(1);
+		return {T(0), q.x()*scale, q.y()*scale, q.z()*scale};
+	}
+	template<typename T>
+	quaternion<T> quaternionExp(const quaternion<T> &q) {
+		const T v = std::sqrt(q.x()*q.x() + q.y()*q.y() + q.z()*q.z());
+		const T scale = v > 0 ? std::sin(v)/v : T(1);
+		return {std::cos(v), q.x()*scale, q.y()*scale, q.z()*scale};
+	}
+
+	//Largest arc between two keys (half their rotation angle) for which nlerp is within tolerance (radians of
+	//rotation angle) of slerp: nlerp's error is arc^3/(18 sqrt 3), and 0.0326 arc^3 bounds it up to arcs of 0.5
+	template<typename T>
+	inline T nlerpMaxArc(T tolerance) {
+		return std::min(T(0.5), std::cbrt(tolerance/T(0.0326)));
+	}
+}
+
+//Normalized linear interpolation: fast, the same path as slerp but not at constant angular velocity
+//(the error is about arc^3/(18 sqrt 3) radians of rotation, for an arc of half the angle between a and b)
+template<typename T>
+std::optional<quaternion<T>> nlerp(const quaternion<T> &a, const quaternion<T> &b, detail::Real<T> t) {
+	if(!a.isRotation() or !b.isRotation()){
+		return std::nullopt;
+	}
+	return detail::nlerpUnit(a, b, static_cast<T>(t));
+}
+template<typename T>
+UnitQuaternion<T> nlerp(const UnitQuaternion<T> &a, const UnitQuaternion<T> &b, detail::Real<T> t) {
+	return UnitQuaternion<T>::fromQuaternion(detail::nlerpUnit(a.value(), b.value(), static_cast<T>(t))).value();
+}
+
+//Spherical linear interpolation: constant angular velocity along the shorter arc
+template<typename T>
+std::optional<quaternion<T>> slerp(const quaternion<T> &a, const quaternion<T> &b, detail::Real<T> t) {
+	if(!a.isRotation() or !b.isRotation()){
+		return std::nullopt;
+	}
+	return detail::slerpUnit(a, b, static_cast<T>(t));
+}
+template<typename T>
+UnitQuaternion<T> slerp(const UnitQuaternion<T> &a, const UnitQuaternion<T> &b, detail::Real<T> t) {
+	return UnitQuaternion<T>::fromQuaternion(detail::slerpUnit(a.value(), b.value(), static_cast<T>(t))).value();
+}
+
+//Control point of squad at key q, between keys previous and next: q exp(-(log(q^-1 next) + log(q^-1 previous))/4)
+template<typename T>
+std::optional<quaternion<T>> squadControlPoint(const quaternion<T> &previous, const quaternion<T> &q, const quaternion<T> &next) {
+	if(!previous.isRotation() or !q.isRotation() or !next.isRotation()){
+		return std::nullopt;
+	}
+	const quaternion<T> toNext = detail::quaternionLog(q.inv()*next), toPrevious = detail::quaternionLog(q.inv()*previous);
+	const T s = T(-0.25);
+	return q*detail::quaternionExp(quaternion<T>{T(0), s*(toNext.x() + toPrevious.x()), s*(toNext.y() + toPrevious.y()), s*(toNext.z() + toPrevious.z())});
+}
+
+//Spherical cubic interpolation between keys q0 and q1, with control points s0 and s1 (squadControlPoint):
+//smooth (C1) across keys, unlike slerp
+template<typename T>
+std::optional<quaternion<T>> squad(const quaternion<T> &q0, const quaternion<T> &q1, const quaternion<T> &s0, const quaternion<T> &s1, detail::Real<T> t) {
+	if(!q0.isRotation() or !q1.isRotation() or !s0.isRotation() or !s1.isRotation()){
+		return std::nullopt;
+	}
+	return detail::squadUnit(q0, q1, s0, s1, static_cast<T>(t));
+}
+
+namespace batch
+{
+	enum class Interpolation { slerp, squad };
+
+	namespace detail
+	{
+		//u in [0, 1] of sample j in the segment from t0 (clamped)
+		template<typename T>
+		inline T segmentParameter(T time, T t0, T inverseDuration) {
+			return std::min(std::max((time - t0)*inverseDuration, T(0)), T(1));
+		}
+
+		//q = a cos(u angle) + c sin(u angle), with fastmath's sincos so that the loop vectorizes
+		template<typename T>
+		inline void arcAt(const ::detail::Arc<T> &arc, T u, T &w, T &x, T &y, T &z) {
+			T sine, cosine;
+			fastmath::sincos(u*arc.angle, sine, cosine);
+			w = arc.a.w()*cosine + arc.c.w()*sine;
+			x = arc.a.x()*cosine + arc.c.x()*sine;
+			y = arc.a.y()*cosine + arc.c.y()*sine;
+			z = arc.a.z()*cosine + arc.c.z()*sine;
+		}
+	}
+
+	//Resamples a keyframe track (keys[k] at keyTimes[k], strictly increasing) at the given times: out[i] is the
+	//interpolated rotation at times[i]. Times outside the keys are clamped to the first or last key.
+	//Keys are unit quaternions; without keys, out is empty. Returns false (and leaves out untouched) if two key
+	//times are equal, out of order or NaN: a segment of zero length has no interpolation parameter.
+	//Samples are processed in runs that fall in the same segment, so sorted times (a dense grid) give long
+	//vectorized loops over the constants of each segment: no acos per sample, one sincos (fastmath) per sample
+	//for slerp, and none where nlerp is within tolerance (radians of rotation angle) of slerp.
+	template<typename T>
+	bool resample(const std::vector<T> &keyTimes, const QuaternionArray<T> &keys, const std::vector<T> &times,
+	              QuaternionArray<T> &out, Interpolation method = Interpolation::slerp, T tolerance = T(1e-6)) {
+		const std::size_t n = times.size(), m = std::min(keyTimes.size(), keys.size());
+		for(std::size_t k = 1; k < m; ++k){
+			if(!(keyTimes[k - 1] < keyTimes[k])){
+				return false;
+			}
+		}
+		if(m == 0){
+			out.resize(0);
+			return true;
+		}
+		out.resize(n);
+		//Keys on one hemisphere, so that every segment takes the shorter arc
+		std::vector<quaternion<T>> q(m);
+		q[0] = keys[0];
+		for(std::size_t k = 1; k < m; ++k){
+			q[k] = ::detail::shorterArc(q[k - 1], keys[k]);
+		}
+		std::vector<quaternion<T>> s;
+		if(method == Interpolation::squad){
+			s = q;
+			for(std::size_t k = 1; k + 1 < m; ++k){ //the end keys are their own control points
+				if(auto control = squadControlPoint(q[k - 1], q[k], q[k + 1])){
+					s[k] = *control;
+				}
+			}
+		}
+		const T maxNlerpArc = ::detail::nlerpMaxArc(tolerance);
+		const T *time = times.data();
+		T *ow = out.w(), *ox = out.x(), *oy = out.y(), *oz = out.z();
+
+		std::size_t i = 0;
+		while(i < n){
+			//segment k: from key k to key k + 1; the first and last segments also take the clamped samples
+			std::size_t k = static_cast<std::size_t>(std::upper_bound(keyTimes.begin(), keyTimes.begin() + m, time[i]) - keyTimes.begin());
+			k = std::min(k == 0 ? 0 : k - 1, m >= 2 ? m - 2 : 0);
+			const T lower = k == 0 ? -std::numeric_limits<T>::infinity() : keyTimes[k];
+			const T upper = k + 2 >= m ? std::numeric_limits<T>::infinity() : keyTimes[k + 1];
+			std::size_t end = i + 1;
+			while(end < n and time[end] >= lower and time[end] < upper){
+				++end;
+			}
+			const std::size_t first = i;
+			i = end;
+
+			if(m == 1){
+				const quaternion<T> key = q[0];
+				std::fill(ow + first, ow + end, key.w());
+				std::fill(ox + first, ox + end, key.x());
+				std::fill(oy + first, oy + end, key.y());
+				std::fill(oz + first, oz + end, key.z());
+				continue;
+			}
+			const T t0 = keyTimes[k], inverseDuration = 1/(keyTimes[k + 1] - keyTimes[k]);
+			const ::detail::Arc<T> arc(q[k], q[k + 1]);
+			if(method == Interpolation::squad){
+				const ::detail::Arc<T> controlArc(s[k], s[k + 1]);
+				batch::detail::forEach(end - first, [=](std::size_t j){
+					const T u = detail::segmentParameter(time[first + j], t0, inverseDuration);
+					T pw, px, py, pz, rw, rx, ry, rz;
+					detail::arcAt(arc, u, pw, px, py, pz);
+					detail::arcAt(controlArc, u, rw, rx, ry, rz);
+					//slerp from p to r by h = 2u(1 - u), without flipping: p cos(h angle) + (r - p d) sin(h angle)/sin(angle),
+					//where |r - p d| is sin(angle); a zero arc falls back to lerp
+					const T h = 2*u*(1 - u);
+					const T d = pw*rw + px*rx + py*ry + pz*rz;
+					const T cw = rw - d*pw, cx = rx - d*px, cy = ry - d*py, cz = rz - d*pz;
+					const T sine = std::sqrt(cw*cw + cx*cx + cy*cy + cz*cz);
+					T sineTo, cosineTo;
+					fastmath::sincos(h*fastmath::atan2(sine, d), sineTo, cosineTo);
+					const bool tiny = sine < T(1e-6);
+					const T to = tiny ? h : sineTo/(tiny ? T(1) : sine);
+					ow[first + j] = cosineTo*pw + to*cw;
+					ox[first + j] = cosineTo*px + to*cx;
+					oy[first + j] = cosineTo*py + to*cy;
+					oz[first + j] = cosineTo*pz + to*cz;
+				});
+			}
+			else if(arc.angle <= maxNlerpArc){
+				const quaternion<T> a = q[k], b = q[k + 1];
+				batch::detail::forEach(end - first, [=](std::size_t j){
+					const T u = detail::segmentParameter(time[first + j], t0, inverseDuration);
+					const T w = (1 - u)*a.w() + u*b.w(), x = (1 - u)*a.x() + u*b.x(), y = (1 - u)*a.y() + u*b.y(), z = (1 - u)*a.z() + u*b.z();
+					const T inverseNorm = 1/std::sqrt(w*w + x*x + y*y + z*z);
+					ow[first + j] = w*inverseNorm;
+					ox[first + j] = x*inverseNorm;
+					oy[first + j] = y*inverseNorm;
+					oz[first + j] = z*inverseNorm;
+				});
+			}
+			else{
+				batch::detail::forEach(end - first, [=](std::size_t j){
+					const T u = detail::segmentParameter(time[first + j], t0, inverseDuration);
+					detail::arcAt(arc, u, ow[first + j], ox[first + j], oy[first + j], oz[first + j]);
+				});
+			}
+		}
+		return true;
+	}
+}
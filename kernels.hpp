@@ -0,0 +1,300 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <algorithm>
+#include <type_traits>
+#include "matrix.hpp"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define ROTATIONS_X86_DISPATCH 1
+#include <immintrin.h>
+#else
+#define ROTATIONS_X86_DISPATCH 0
+#endif
+
+//GCC contracts a*b + c into an FMA whenever the target has one (also for intrinsics), which would
+//break the bit-for-bit agreement between the kernels
+#if defined(__GNUC__) && !defined(__clang__)
+#define ROTATIONS_NO_FP_CONTRACT __attribute__((optimize("fp-contract=off")))
+#else
+#define ROTATIONS_NO_FP_CONTRACT
+#endif
+
+//Bulk rotation kernels: rotate n points by a 3x3 matrix, or move them by a rigid transform.
+//
+//Every path computes each coordinate as (m0*x + m1*y) + m2*z, with separately rounded
+//multiplies and adds and no FMA, so the SIMD results are bit-for-bit identical to the
+//scalar fallback (0 ULP). GCC is kept from contracting the kernels into FMAs by
+//ROTATIONS_NO_FP_CONTRACT. Other compilers built with FMA contraction enabled (e.g.
+//clang with -march=native) may fuse the scalar loop; each coordinate of the scalar
+//result then differs by at most 2 ULP of the largest of the three products.
+//
+//The widest instruction set supported by the CPU is detected once, on first use.
+//Input and output may be the same arrays (in-place rotation).
+namespace simd
+{
+	enum class Isa { scalar, sse2, avx2, avx512 };
+
+	inline bool isSupported(Isa isa) {
+		switch(isa){
+			case Isa::scalar:
+				return true;
+#if ROTATIONS_X86_DISPATCH
+			case Isa::sse2:
+				return __builtin_cpu_supports("sse2");
+			case Isa::avx2:
+				return __builtin_cpu_supports("avx2");
+			case Isa::avx512:
+				return __builtin_cpu_supports("avx512f");
+#endif
+			default:
+				return false;
+		}
+	}
+
+	//Widest supported instruction set, detected once
+	inline Isa activeIsa() {
+		static const Isa isa = []{
+#if ROTATIONS_X86_DISPATCH
+			__builtin_cpu_init();
+#endif
+			for(Isa candidate : {Isa::avx512, Isa::avx2, Isa::sse2}){
+				if(isSupported(candidate)){
+					return candidate;
+				}
+			}
+			return Isa::scalar;
+		}();
+		return isa;
+	}
+
+	namespace detail
+	{
+		template<typename T>
+		ROTATIONS_NO_FP_CONTRACT void rotateScalar(const T *m, const T *x, const T *y, const T *z,
+		                                           T *xOut, T *yOut, T *zOut, std::size_t n)
+		{
+			const T m00 = m[0], m01 = m[1], m02 = m[2];
+			const T m10 = m[3], m11 = m[4], m12 = m[5];
+			const T m20 = m[6], m21 = m[7], m22 = m[8];
+			for(std::size_t i = 0; i < n; ++i){
+				const T px = x[i], py = y[i], pz = z[i];
+				xOut[i] = m00*px + m01*py + m02*pz;
+				yOut[i] = m10*px + m11*py + m12*pz;
+				zOut[i] = m20*px + m21*py + m22*pz;
+			}
+		}
+
+		//out = m (p - c) + d: rotation about c followed by a translation, in one pass
+		template<typename T>
+		ROTATIONS_NO_FP_CONTRACT void transformScalar(const T *m, const T *c, const T *d, const T *x, const T *y, const T *z,
+		                                              T *xOut, T *yOut, T *zOut, std::size_t n)
+		{
+			const T m00 = m[0], m01 = m[1], m02 = m[2];
+			const T m10 = m[3], m11 = m[4], m12 = m[5];
+			const T m20 = m[6], m21 = m[7], m22 = m[8];
+			const T cx = c[0], cy = c[1], cz = c[2], dx = d[0], dy = d[1], dz = d[2];
+			for(std::size_t i = 0; i < n; ++i){
+				const T px = x[i] - cx, py = y[i] - cy, pz = z[i] - cz;
+				xOut[i] = (m00*px + m01*py + m02*pz) + dx;
+				yOut[i] = (m10*px + m11*py + m12*pz) + dy;
+				zOut[i] = (m20*px + m21*py + m22*pz) + dz;
+			}
+		}
+
+#if ROTATIONS_X86_DISPATCH
+//One kernel per (instruction set, scalar type): full vectors first, the remainder with the scalar loop
+#define ROTATIONS_SOA_KERNEL(NAME, TARGET, T, VEC, WIDTH, SET1, LOADU, STOREU, MUL, ADD)              \
+		__attribute__((target(TARGET))) ROTATIONS_NO_FP_CONTRACT inline void                            \
+		NAME(const T *m, const T *x, const T *y, const T *z, T *xOut, T *yOut, T *zOut, std::size_t n)  \
+		{                                                                                               \
+			const VEC m00 = SET1(m[0]), m01 = SET1(m[1]), m02 = SET1(m[2]);                             \
+			const VEC m10 = SET1(m[3]), m11 = SET1(m[4]), m12 = SET1(m[5]);                             \
+			const VEC m20 = SET1(m[6]), m21 = SET1(m[7]), m22 = SET1(m[8]);                             \
+			std::size_t i = 0;                                                                          \
+			for(; i + WIDTH <= n; i += WIDTH){                                                          \
+				const VEC px = LOADU(x + i), py = LOADU(y + i), pz = LOADU(z + i);                      \
+				STOREU(xOut + i, ADD(ADD(MUL(m00, px), MUL(m01, py)), MUL(m02, pz)));                   \
+				STOREU(yOut + i, ADD(ADD(MUL(m10, px), MUL(m11, py)), MUL(m12, pz)));                   \
+				STOREU(zOut + i, ADD(ADD(MUL(m20, px), MUL(m21, py)), MUL(m22, pz)));                   \
+			}                                                                                           \
+			rotateScalar(m, x + i, y + i, z + i, xOut + i, yOut + i, zOut + i, n - i);                  \
+		}
+
+		ROTATIONS_SOA_KERNEL(rotateSse2, "sse2", double, __m128d, 2, _mm_set1_pd, _mm_loadu_pd, _mm_storeu_pd, _mm_mul_pd, _mm_add_pd)
+		ROTATIONS_SOA_KERNEL(rotateSse2, "sse2", float, __m128, 4, _mm_set1_ps, _mm_loadu_ps, _mm_storeu_ps, _mm_mul_ps, _mm_add_ps)
+		ROTATIONS_SOA_KERNEL(rotateAvx2, "avx2", double, __m256d, 4, _mm256_set1_pd, _mm256_loadu_pd, _mm256_storeu_pd, _mm256_mul_pd, _mm256_add_pd)
+		ROTATIONS_SOA_KERNEL(rotateAvx2, "avx2", float, __m256, 8, _mm256_set1_ps, _mm256_loadu_ps, _mm256_storeu_ps, _mm256_mul_ps, _mm256_add_ps)
+		ROTATIONS_SOA_KERNEL(rotateAvx512, "avx512f", double, __m512d, 8, _mm512_set1_pd, _mm512_loadu_pd, _mm512_storeu_pd, _mm512_mul_pd, _mm512_add_pd)
+		ROTATIONS_SOA_KERNEL(rotateAvx512, "avx512f", float, __m512, 16, _mm512_set1_ps, _mm512_loadu_ps, _mm512_storeu_ps, _mm512_mul_ps, _mm512_add_ps)
+
+#define ROTATIONS_AFFINE_KERNEL(NAME, TARGET, T, VEC, WIDTH, SET1, LOADU, STOREU, MUL, ADD, SUB)                       \
+		__attribute__((target(TARGET))) ROTATIONS_NO_FP_CONTRACT inline void                                        \
+		NAME(const T *m, const T *c, const T *d, const T *x, const T *y, const T *z, T *xOut, T *yOut, T *zOut,     \
+		     std::size_t n)                                                                                         \
+		{                                                                                                           \
+			const VEC m00 = SET1(m[0]), m01 = SET1(m[1]), m02 = SET1(m[2]);                                         \
+			const VEC m10 = SET1(m[3]), m11 = SET1(m[4]), m12 = SET1(m[5]);                                         \
+			const VEC m20 = SET1(m[6]), m21 = SET1(m[7]), m22 = SET1(m[8]);                                         \
+			const VEC cx = SET1(c[0]), cy = SET1(c[1]), cz = SET1(c[2]), dx = SET1(d[0]), dy = SET1(d[1]), dz = SET1(d[2]); \
+			std::size_t i = 0;                                                                                      \
+			for(; i + WIDTH <= n; i += WIDTH){                                                                      \
+				const VEC px = SUB(LOADU(x + i), cx), py = SUB(LOADU(y + i), cy), pz = SUB(LOADU(z + i), cz);       \
+				STOREU(xOut + i, ADD(ADD(ADD(MUL(m00, px), MUL(m01, py)), MUL(m02, pz)), dx));                      \
+				STOREU(yOut + i, ADD(ADD(ADD(MUL(m10, px), MUL(m11, py)), MUL(m12, pz)), dy));                      \
+				STOREU(zOut + i, ADD(ADD(ADD(MUL(m20, px), MUL(m21, py)), MUL(m22, pz)), dz));                      \
+			}                                                                                                       \
+			transformScalar(m, c, d, x + i, y + i, z + i, xOut + i, yOut + i, zOut + i, n - i);                     \
+		}
+
+		ROTATIONS_AFFINE_KERNEL(transformSse2, "sse2", double, __m128d, 2, _mm_set1_pd, _mm_loadu_pd, _mm_storeu_pd, _mm_mul_pd, _mm_add_pd, _mm_sub_pd)
+		ROTATIONS_AFFINE_KERNEL(transformSse2, "sse2", float, __m128, 4, _mm_set1_ps, _mm_loadu_ps, _mm_storeu_ps, _mm_mul_ps, _mm_add_ps, _mm_sub_ps)
+		ROTATIONS_AFFINE_KERNEL(transformAvx2, "avx2", double, __m256d, 4, _mm256_set1_pd, _mm256_loadu_pd, _mm256_storeu_pd, _mm256_mul_pd, _mm256_add_pd, _mm256_sub_pd)
+		ROTATIONS_AFFINE_KERNEL(transformAvx2, "avx2", float, __m256, 8, _mm256_set1_ps, _mm256_loadu_ps, _mm256_storeu_ps, _mm256_mul_ps, _mm256_add_ps, _mm256_sub_ps)
+		ROTATIONS_AFFINE_KERNEL(transformAvx512, "avx512f", double, __m512d, 8, _mm512_set1_pd, _mm512_loadu_pd, _mm512_storeu_pd, _mm512_mul_pd, _mm512_add_pd, _mm512_sub_pd)
+		ROTATIONS_AFFINE_KERNEL(transformAvx512, "avx512f", float, __m512, 16, _mm512_set1_ps, _mm512_loadu_ps, _mm512_storeu_ps, _mm512_mul_ps, _mm512_add_ps, _mm512_sub_ps)
+
+#undef ROTATIONS_SOA_KERNEL
+#undef ROTATIONS_AFFINE_KERNEL
+#endif
+
+		template<typename T>
+		void rotateSoA(Isa isa, const T *m, const T *x, const T *y, const T *z,
+		               T *xOut, T *yOut, T *zOut, std::size_t n)
+		{
+#if ROTATIONS_X86_DISPATCH
+			if constexpr(std::is_same_v<T, float> or std::is_same_v<T, double>){
+				switch(isa){
+					case Isa::avx512:
+						return rotateAvx512(m, x, y, z, xOut, yOut, zOut, n);
+					case Isa::avx2:
+						return rotateAvx2(m, x, y, z, xOut, yOut, zOut, n);
+					case Isa::sse2:
+						return rotateSse2(m, x, y, z, xOut, yOut, zOut, n);
+					default:
+						break;
+				}
+			}
+#endif
+			(void)isa;
+			rotateScalar(m, x, y, z, xOut, yOut, zOut, n);
+		}
+
+		template<typename T>
+		void transformSoA(Isa isa, const T *m, const T *c, const T *d, const T *x, const T *y, const T *z,
+		                  T *xOut, T *yOut, T *zOut, std::size_t n)
+		{
+#if ROTATIONS_X86_DISPATCH
+			if constexpr(std::is_same_v<T, float> or std::is_same_v<T, double>){
+				switch(isa){
+					case Isa::avx512:
+						return transformAvx512(m, c, d, x, y, z, xOut, yOut, zOut, n);
+					case Isa::avx2:
+						return transformAvx2(m, c, d, x, y, z, xOut, yOut, zOut, n);
+					case Isa::sse2:
+						return transformSse2(m, c, d, x, y, z, xOut, yOut, zOut, n);
+					default:
+						break;
+				}
+			}
+#endif
+			(void)isa;
+			transformScalar(m, c, d, x, y, z, xOut, yOut, zOut, n);
+		}
+
+		template<typename T>
+		std::array<T,9> coefficients(const Matrix3<T> &M) {
+			std::array<T,9> m;
+			std::copy(M.cbegin(), M.cend(), m.begin());
+			return m;
+		}
+	}
+
+	//Structure of arrays: x, y, z in separate arrays
+	template<typename T>
+	void rotateSoA(Isa isa, const Matrix3<T> &M, const T *x, const T *y, const T *z,
+	               T *xOut, T *yOut, T *zOut, std::size_t n)
+	{
+		const auto m = detail::coefficients(M);
+		detail::rotateSoA(isa, m.data(), x, y, z, xOut, yOut, zOut, n);
+	}
+
+	template<typename T>
+	void rotateSoA(const Matrix3<T> &M, const T *x, const T *y, const T *z,
+	               T *xOut, T *yOut, T *zOut, std::size_t n)
+	{
+		rotateSoA(activeIsa(), M, x, y, z, xOut, yOut, zOut, n);
+	}
+
+	//Rigid transform, fused: out = M (p - center) + offset, one pass over the points instead of three
+	//(centering, rotation, translation). Same bit-for-bit agreement between the instruction sets.
+	template<typename T>
+	void transformSoA(Isa isa, const Matrix3<T> &M, const std::array<T,3> &center, const std::array<T,3> &offset,
+	                  const T *x, const T *y, const T *z, T *xOut, T *yOut, T *zOut, std::size_t n)
+	{
+		const auto m = detail::coefficients(M);
+		detail::transformSoA(isa, m.data(), center.data(), offset.data(), x, y, z, xOut, yOut, zOut, n);
+	}
+
+	template<typename T>
+	void transformSoA(const Matrix3<T> &M, const std::array<T,3> &center, const std::array<T,3> &offset,
+	                  const T *x, const T *y, const T *z, T *xOut, T *yOut, T *zOut, std::size_t n)
+	{
+		transformSoA(activeIsa(), M, center, offset, x, y, z, xOut, yOut, zOut, n);
+	}
+
+	//Array of structures: interleaved std::array<T,3> points.
+	//Points are deinterleaved in small blocks that stay in L1, rotated with the SoA kernel, and interleaved back.
+	template<typename T>
+	void rotateAoS(Isa isa, const Matrix3<T> &M, const std::array<T,3> *in, std::array<T,3> *out, std::size_t n)
+	{
+		static_assert(sizeof(std::array<T,3>) == 3*sizeof(T), "points must be tightly packed");
+		constexpr std::size_t block = 256;
+		alignas(64) T x[block], y[block], z[block];
+		const auto m = detail::coefficients(M);
+		for(std::size_t start = 0; start < n; start += block){
+			const std::size_t count = std::min(block, n - start);
+			for(std::size_t i = 0; i < count; ++i){
+				x[i] = in[start + i][0];
+				y[i] = in[start + i][1];
+				z[i] = in[start + i][2];
+			}
+			detail::rotateSoA(isa, m.data(), x, y, z, x, y, z, count);
+			for(std::size_t i = 0; i < count; ++i){
+				out[start + i] = {x[i], y[i], z[i]};
+			}
+		}
+	}
+
+	template<typename T>
+	void rotateAoS(const Matrix3<T> &M, const std::array<T,3> *in, std::array<T,3> *out, std::size_t n)
+	{
+		rotateAoS(activeIsa(), M, in, out, n);
+	}
+
+	//Interleaved points in, structure of arrays out (e.g. a mapped aos file rotated into Points): the same blocks,
+	//rotated straight into the output arrays
+	template<typename T>
+	void rotateAoS(Isa isa, const Matrix3<T> &M, const std::array<T,3> *in, T *xOut, T *yOut, T *zOut, std::size_t n)
+	{
+		static_assert(sizeof(std::array<T,3>) == 3*sizeof(T), "points must be tightly packed");
+		constexpr std::size_t block = 256;
+		alignas(64) T x[block], y[block], z[block];
+		const auto m = detail::coefficients(M);
+		for(std::size_t start = 0; start < n; start += block){
+			const std::size_t count = std::min(block, n - start);
+			for(std::size_t i = 0; i < count; ++i){
+				x[i] = in[start + i][0];
+				y[i] = in[start + i][1];
+				z[i] = in[start + i][2];
+			}
+			detail::rotateSoA(isa, m.data(), x, y, z, xOut + start, yOut + start, zOut + start, count);
+		}
+	}
+
+	template<typename T>
+	void rotateAoS(const Matrix3<T> &M, const std::array<T,3> *in, T *xOut, T *yOut, T *zOut, std::size_t n)
+	{
+		rotateAoS(activeIsa(), M, in, xOut, yOut, zOut, n);
+	}
+}
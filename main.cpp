@@ -8,62 +8,26 @@
 #include <string>
 #include <fstream>
 #include "testCompatibility.hpp"
+#include "testPoints.hpp"
+#include "testKernels.hpp"
+#include "testPointFile.hpp"
+#include "testAccumulator.hpp"
+#include "testBatchConversion.hpp"
+#include "testConstexpr.hpp"
+#include "testPrecision.hpp"
+#include "testInterpolation.hpp"
+#include "testFastTrig.hpp"
+#include "testRotationTable.hpp"
+#include "testBatchRotation.hpp"
+#include "testAllocation.hpp"
+#include "testRigidTransform.hpp"
+#include "testFitting.hpp"
+#include "testAveraging.hpp"
+#include "testOrientationIndex.hpp"
+#include "testRandomRotations.hpp"
+#include "points.hpp"
 #include <optional>
 
-typedef std::array<double,3> point;
-class Points{
-    private: 
-    std::vector<point> data;
-    public:
-    Points():data{}{};
-    Points(const std::vector<point> &d): data{d}{}; //construct from data mtx
-    Points(const std::string & filename) { //construct from file
-        std::ifstream myfile(filename);
-        data.reserve(1000);
-        double x, y, z;
-        while (myfile >> x >> y >> z) { //Read a row of the file
-            point read {x, y, z};
-            data.push_back(read);
-        }
-    }
-    Points rotate(const std::optional<quaternion<double>> &quaternion) const {
-        std::vector<point> rotated;
-        if(quaternion){
-            rotated.reserve(data.size());
-            for(auto e : data){
-                auto result = rotateByQuaternion(quaternion.value(), e);
-                if(result){ // rotate each point, push back to result vector if succesful.
-                    rotated.push_back(result.value());
-                }
-            }
-        }
-        return Points(rotated);
-
-    }
-
-    Points rotate(const std::optional<Matrix3<double>> &M) const {
-        std::vector<point> rotated;
-        if(M){
-            rotated.reserve(data.size());
-            for(auto e : data){
-                auto result = M.value()*e;
-                if(result){ // rotate each point, push back to result vector if succesful.
-                    rotated.push_back(result.value());
-                }
-            }
-        }
-        return Points(rotated);
-    }
-    void writeToFile(const std::string & filename) const {
-        std::ofstream output;
-        output.open(filename);
-        for(auto e : data){
-            output << e[0] << " " << e[1] << " " << e[2] << "\n";
-        }
-    }
-};
-  
-
 int main() {
     //Basic Test cases:
 
@@ -71,6 +35,25 @@ int main() {
     TestMatrix();
     TestAxisAngle();
     TestCompatibility();
+    TestPoints();
+    TestKernels();
+    TestPointFile();
+    TestTextFormat();
+    TestPointStream();
+    TestAccumulator();
+    TestBatchConversion();
+    TestConstexpr();
+    TestPrecision();
+    TestInterpolation();
+    TestFastTrig();
+    TestRotationTable();
+    TestBatchRotation();
+    TestAllocation();
+    TestRigidTransform();
+    TestFitting();
+    TestAveraging();
+    TestOrientationIndex();
+    TestRandomRotations();
     //
 
     //Rotating an ellipse :
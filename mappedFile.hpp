@@ -0,0 +1,106 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include <cstddef>
+#include <optional>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define ROTATIONS_HAVE_MMAP 1
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#define ROTATIONS_HAVE_MMAP 0
+#endif
+
+//Read-only bytes of a file. Uses mmap where available, so opening is O(1) and the
+//contents are paged in on first use; otherwise the file is read into memory (8 byte aligned).
+class MappedFile{
+	private:
+	const unsigned char *base = nullptr;
+	std::size_t length = 0;
+#if !ROTATIONS_HAVE_MMAP
+	std::vector<std::uint64_t> buffer;
+#endif
+
+	MappedFile() = default;
+
+	void release() {
+#if ROTATIONS_HAVE_MMAP
+		if(base){
+			munmap(const_cast<unsigned char*>(base), length);
+		}
+#endif
+		base = nullptr;
+		length = 0;
+	}
+
+	public:
+	MappedFile( MappedFile const& ) = delete;
+	MappedFile& operator=(MappedFile const&) = delete;
+	MappedFile(MappedFile &&other) noexcept {
+		*this = std::move(other);
+	}
+	MappedFile& operator=(MappedFile &&other) noexcept {
+		if(this != &other){
+			release();
+			std::swap(base, other.base);
+			std::swap(length, other.length);
+#if !ROTATIONS_HAVE_MMAP
+			buffer = std::move(other.buffer);
+#endif
+		}
+		return *this;
+	}
+	~MappedFile() {
+		release();
+	}
+
+	//Fails if the file cannot be read or is shorter than minimumSize
+	static std::optional<MappedFile> open(const std::string &filename, std::size_t minimumSize = 0) {
+		MappedFile file;
+#if ROTATIONS_HAVE_MMAP
+		int fd = ::open(filename.c_str(), O_RDONLY);
+		if(fd < 0){
+			return std::nullopt;
+		}
+		struct stat info;
+		if(fstat(fd, &info) != 0 or static_cast<std::size_t>(info.st_size) < minimumSize or info.st_size == 0){
+			::close(fd);
+			return std::nullopt;
+		}
+		file.length = static_cast<std::size_t>(info.st_size);
+		void *mapped = mmap(nullptr, file.length, PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		if(mapped == MAP_FAILED){
+			return std::nullopt;
+		}
+		file.base = static_cast<const unsigned char*>(mapped);
+#else
+		std::ifstream input(filename, std::ios::binary | std::ios::ate);
+		if(!input){
+			return std::nullopt;
+		}
+		file.length = static_cast<std::size_t>(input.tellg());
+		if(file.length < minimumSize or file.length == 0){
+			return std::nullopt;
+		}
+		file.buffer.resize((file.length + 7) / 8);
+		input.seekg(0);
+		input.read(reinterpret_cast<char*>(file.buffer.data()), file.length);
+		file.base = reinterpret_cast<const unsigned char*>(file.buffer.data());
+#endif
+		return file;
+	}
+
+	const unsigned char* data() const {
+		return base;
+	}
+	std::size_t size() const {
+		return length;
+	}
+};
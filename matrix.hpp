@@ -6,41 +6,77 @@
 #include <initializer_list>
 #include <cmath>
 #include <optional>
+#include <type_traits>
+#include "precision.hpp"
+#include "fastMath.hpp"
 #include "quaternion.hpp"
 #include "axisAngle.hpp"
 
+namespace detail
+{
+	//Shepperd's method without branches: the square root is taken of the largest of 4w^2, 4x^2, 4y^2, 4z^2,
+	//so it never divides by a small number. The choice is a one-hot weight (0 or 1, exact) instead of nested
+	//selects, which GCC does not if-convert. The result has w >= 0.
+	template<typename T>
+	inline void matrixToQuaternion(T m00, T m01, T m02, T m10, T m11, T m12, T m20, T m21, T m22,
+	                               T &w, T &x, T &y, T &z) {
+		const T trace = m00 + m11 + m22;
+		const bool useW = (trace >= m00) & (trace >= m11) & (trace >= m22);
+		const bool useX = !useW & (m00 >= m11) & (m00 >= m22);
+		const bool useY = !useW & !useX & (m11 >= m22);
+		const T cW = useW ? T(1) : T(0), cX = useX ? T(1) : T(0), cY = useY ? T(1) : T(0), cZ = T(1) - cW - cX - cY;
+		//1 + trace = 4w^2, 1 + m00 - m11 - m22 = 4x^2, ...
+		const T d = cW*(T(1) + trace) + cX*(T(1) + m00 - m11 - m22) + cY*(T(1) - m00 + m11 - m22) + cZ*(T(1) - m00 - m11 + m22);
+		const T big = T(0.5)*std::sqrt(d);
+		const T f = T(0.25)/big;
+		const T wDiff = m21 - m12, yDiff = m02 - m20, zDiff = m10 - m01; //4wx, 4wy, 4wz
+		const T xySum = m01 + m10, xzSum = m02 + m20, yzSum = m12 + m21; //4xy, 4xz, 4yz
+		w = cW*big + f*(cX*wDiff + cY*yDiff + cZ*zDiff);
+		x = cX*big + f*(cW*wDiff + cY*xySum + cZ*xzSum);
+		y = cY*big + f*(cW*yDiff + cX*xySum + cZ*yzSum);
+		z = cZ*big + f*(cW*zDiff + cX*xzSum + cY*yzSum);
+		const T sign = w < T(0) ? T(-1) : T(1); //q and -q are the same rotation
+		w *= sign;
+		x *= sign;
+		y *= sign;
+		z *= sign;
+	}
+}
 
+//Row major 3x3 matrix. Only the 9 elements are stored: arrays of matrices can be copied with memcpy,
+//mapped from files and handed to kernels as plain T[9] blocks (checked below the class).
 template<typename T>
 class Matrix3{
 	private: 
-	int N = 3;
+	static constexpr int N = 3;
 	std::array<T,9> data;
 	public:
+	using value_type = T;
     /**
 	*  Constructor
     */
-	Matrix3():data{}{};
-	Matrix3(std::array<T,9> vec): data{vec}{}; //1 vector
+	constexpr Matrix3():data{}{};
+	constexpr Matrix3(std::array<T,9> vec): data{vec}{}; //1 vector
 	Matrix3( Matrix3 const& ) = default; //copy const       
 	
-	T& operator[]( int i ) { 
+	constexpr T& operator[]( int i ) { 
 		return data[i];
 	}
-    T const& operator[]( int i ) const { //read only
+    constexpr T const& operator[]( int i ) const { //read only
 		return data[i];
 	}
-    T& operator()(int i, int j) {
+    constexpr T& operator()(int i, int j) {
 		return data[N*i+j];
 	}
-    T const& operator()(int i, int j) const { //read only 
+    constexpr T const& operator()(int i, int j) const { //read only 
  		return data[N*i+j]; 
 	}
 	
 	Matrix3<T>& operator=(Matrix3 const&) = default;
-	int size() const {
+	constexpr int size() const {
 		return static_cast<int>(data.size());
 	}
-	T determinant() const {
+	constexpr T determinant() const {
 		//Determinant computed from components
 		auto m = *this;
 		T det = m(0, 0) * (m(1, 1) * m(2, 2) - m(2, 1) * m(1, 2)) -
@@ -49,26 +85,42 @@ class Matrix3{
 
 		return det;
 	}
-	bool isRotation() const {
-		return (std::abs(determinant() - 1.) < 1e-6);  //3x3 rotation matrix
+	constexpr bool isRotation() const {
+		const detail::Real<T> deviation = determinant() - detail::Real<T>(1); //no std::abs, to stay usable in constant expressions
+		if(!(deviation > -detail::rotationTolerance<T> and deviation < detail::rotationTolerance<T>)){
+			return false;
+		}
+		//a shear or a scaling can have det 1 too: the columns must also be orthonormal, M^T M = I
+		auto m = *this;
+		for(int i = 0; i < N; i++){
+			for(int j = i; j < N; j++){
+				const detail::Real<T> dot = detail::Real<T>(m(0, i))*m(0, j) + detail::Real<T>(m(1, i))*m(1, j) + detail::Real<T>(m(2, i))*m(2, j)
+				                          - (i == j ? detail::Real<T>(1) : detail::Real<T>(0));
+				if(!(dot > -detail::rotationTolerance<T> and dot < detail::rotationTolerance<T>)){
+					return false;
+				}
+			}
+		}
+		return true;  //3x3 rotation matrix
 	}
 
 	//Conversion functions: 
+	//Shepperd's method (detail::matrixToQuaternion above, shared with batch::convertToQuaternion): robust for
+	//every rotation, including the identity and rotations by pi. The result has w >= 0.
 	std::optional<quaternion<T>> convertToQuaternion() const {
-		if(isRotation()) {
+		if(!isRotation()) {
 			return std::nullopt; //Not a rotation matrix
 		}
 		else{
 			auto m = *this;
-			T x = 0.5 * std::sqrt(1 + m(0, 0) - m(1, 1) - m(2, 2));
-			T y = (m(0, 1) + m(1, 0)) / (4 * x);
-			T z = (m(0, 2) + m(2, 0)) / (4 * x);
-			T w = (m(2, 1) - m(1, 2)) / (4 * x);
+			T w, x, y, z;
+			detail::matrixToQuaternion(m(0, 0), m(0, 1), m(0, 2), m(1, 0), m(1, 1), m(1, 2), m(2, 0), m(2, 1), m(2, 2), w, x, y, z);
 			quaternion<T> result {w, x, y, z};
 			return result;
 		}
 	}
-	//converting to axis-angle representation:
+	//converting to axis-angle representation (Trig: StdTrig or FastTrig, see fastMath.hpp):
+	template<typename Trig = StdTrig>
 	std::optional<axisAngle<T>> convertToAxisAngle() const {
 		if(!isRotation()) {
 			return std::nullopt; //Not a rotation matrix
@@ -76,10 +128,10 @@ class Matrix3{
 		else{
 			auto m = *this;
 			std::array<T,3> axis {m(2,1) - m(1, 2), m(0, 2) - m(2, 0), m(1, 0) - m(0, 1)}; //the lenght of this is 2*sin(\alpha)
-			T s2 = std::sqrt(std::inner_product(axis.begin(), axis.end(), axis.begin(), 0.));
+			T s2 = std::sqrt(std::inner_product(axis.begin(), axis.end(), axis.begin(), T(0)));
 
 			std::transform(axis.begin(), axis.end(), axis.begin(), [s2](T x){return x / s2;}); //Normed axis
-			T angle = std::asin(s2/2.);
+			T angle = Trig::atan2(s2, m(0, 0) + m(1, 1) + m(2, 2) - 1); //s2 = 2 sin, trace - 1 = 2 cos: angles up to pi, unlike asin
 			axisAngle<T> result(axis, angle);
 			return result;
 		}
@@ -102,15 +154,51 @@ class Matrix3{
 		return data.cend();
 	}
 
+	//Elements, row major
+	T* elements() {
+		return data.data();
+	}
+	const T* elements() const {
+		return data.data();
+	}
 };
-//Rotating a vector: 
+
+static_assert(sizeof(Matrix3<double>) == 9*sizeof(double) and sizeof(Matrix3<float>) == 9*sizeof(float), "Matrix3 must hold only its elements");
+static_assert(std::is_trivially_copyable_v<Matrix3<double>> and std::is_standard_layout_v<Matrix3<double>>, "Matrix3 must be trivially copyable");
+
+//Matrix3 with every row padded to 4 elements (the padding is 0), aligned so that each row is one aligned
+//SIMD load: 16 bytes for float, 32 for double
 template<typename T>
-std::optional<std::array<T,3>> operator*(const Matrix3<T> &M, const std::array<T,3> &v){
-	if(!M.isRotation()){
-		return std::nullopt;
+class alignas(4*sizeof(T)) Matrix3x4{
+	private:
+	std::array<T,12> data;
+	public:
+	constexpr Matrix3x4(): data{} {}
+	constexpr explicit Matrix3x4(const Matrix3<T> &M): data{{M(0, 0), M(0, 1), M(0, 2), 0,
+	                                                         M(1, 0), M(1, 1), M(1, 2), 0,
+	                                                         M(2, 0), M(2, 1), M(2, 2), 0}} {}
+
+	constexpr T const& operator()(int i, int j) const { //read only
+		return data[4*i + j];
 	}
-	else{
-		std::array<T,3> result;
+	constexpr Matrix3<T> matrix() const {
+		return Matrix3<T>({data[0], data[1], data[2], data[4], data[5], data[6], data[8], data[9], data[10]});
+	}
+	//Row i: 4 elements, the last one 0
+	const T* row(int i) const {
+		return data.data() + 4*i;
+	}
+};
+
+static_assert(sizeof(Matrix3x4<double>) == 12*sizeof(double) and alignof(Matrix3x4<double>) == 32, "Matrix3x4<double> layout");
+static_assert(sizeof(Matrix3x4<float>) == 12*sizeof(float) and alignof(Matrix3x4<float>) == 16, "Matrix3x4<float> layout");
+static_assert(std::is_trivially_copyable_v<Matrix3x4<double>> and std::is_standard_layout_v<Matrix3x4<double>>, "Matrix3x4 must be trivially copyable");
+namespace detail
+{
+	//M v, without the rotation check
+	template<typename T>
+	constexpr std::array<T,3> multiply(const Matrix3<T> &M, const std::array<T,3> &v) {
+		std::array<T,3> result{};
 		for(int i = 0; i < 3; ++i){
 			T sum = 0.0;
 			for(int j = 0; j < 3; ++j){
@@ -120,21 +208,182 @@ std::optional<std::array<T,3>> operator*(const Matrix3<T> &M, const std::array<T
 		}
 		return result;
 	}
+
+	template<typename T>
+	constexpr Matrix3<T> multiply(const Matrix3<T> &m1, const Matrix3<T> &m2) {
+		Matrix3<T> result;
+		for(int i=0;i<3;i++) {
+			for(int j=0;j<3;j++) {
+				T sum = 0.0;
+				for(int k=0;k<3;k++) {
+					sum += m1(i,k)*m2(k,j);
+				}
+				result(i,j) = sum;
+			}
+		}
+		return result;
+	}
+}
+
+//Rotating a vector: 
+template<typename T>
+constexpr std::optional<std::array<T,3>> operator*(const Matrix3<T> &M, const std::array<T,3> &v){
+	if(!M.isRotation()){
+		return std::nullopt;
+	}
+	else{
+		return detail::multiply(M, v);
+	}
+}
+
+
+//Matrix multiplication is lazy: m1*m2*m3 is an expression holding its factors, evaluated where it is used.
+//Assigned to a Matrix3 it multiplies out (27 multiplies per product, as before). apply() takes a vector right to
+//left, m1*(m2*(m3*v)), 9 multiplies per factor and no intermediate matrices, without a rotation check.
+//Factors are held by value, so an expression never refers to a destroyed temporary.
+template<typename L, typename R>
+class MatrixProduct;
+
+namespace detail
+{
+	template<typename L, typename R>
+	constexpr std::array<typename L::value_type,3> multiply(const MatrixProduct<L, R> &P, const std::array<typename L::value_type,3> &v);
 }
 
+template<typename L, typename R>
+class MatrixProduct{
+	private:
+	L left;
+	R right;
+	public:
+	using value_type = typename L::value_type;
+
+	constexpr MatrixProduct(const L &l, const R &r): left{l}, right{r} {}
+
+	constexpr Matrix3<value_type> evaluate() const {
+		return detail::multiply(Matrix3<value_type>(left), Matrix3<value_type>(right));
+	}
+	constexpr operator Matrix3<value_type>() const {
+		return evaluate();
+	}
 
-//Matrix multiplication
+	//(left right) v, without the rotation check
+	constexpr std::array<value_type,3> apply(const std::array<value_type,3> &v) const {
+		return detail::multiply(left, detail::multiply(right, v));
+	}
+
+	//the determinant of a product is the product of the determinants
+	constexpr value_type determinant() const {
+		return left.determinant()*right.determinant();
+	}
+	//a product of rotations is a rotation, so the factors are checked on their own; factors that are not
+	//rotations can still multiply to one, and only then is the product multiplied out and checked
+	constexpr bool isRotation() const {
+		return (left.isRotation() and right.isRotation()) or evaluate().isRotation();
+	}
+};
+
+namespace detail
+{
+	template<typename L, typename R>
+	constexpr std::array<typename L::value_type,3> multiply(const MatrixProduct<L, R> &P, const std::array<typename L::value_type,3> &v) { //factor of a longer product
+		return P.apply(v);
+	}
+}
+
+template<typename T>
+constexpr MatrixProduct<Matrix3<T>, Matrix3<T>> operator*(const Matrix3<T> &m1, const Matrix3<T> &m2) {
+	return {m1, m2};
+}
+template<typename L, typename R, typename T>
+constexpr MatrixProduct<MatrixProduct<L, R>, Matrix3<T>> operator*(const MatrixProduct<L, R> &p, const Matrix3<T> &m) {
+	return {p, m};
+}
+template<typename T, typename L, typename R>
+constexpr MatrixProduct<Matrix3<T>, MatrixProduct<L, R>> operator*(const Matrix3<T> &m, const MatrixProduct<L, R> &p) {
+	return {m, p};
+}
+template<typename L1, typename R1, typename L2, typename R2>
+constexpr MatrixProduct<MatrixProduct<L1, R1>, MatrixProduct<L2, R2>> operator*(const MatrixProduct<L1, R1> &p1, const MatrixProduct<L2, R2> &p2) {
+	return {p1, p2};
+}
+
+//Rotating a vector by a product, checked like Matrix3 * vector. Checking every factor costs more than multiplying
+//the product out and checking it once, so that is what is done, and the one matrix is applied.
+template<typename L, typename R, typename T>
+constexpr std::optional<std::array<T,3>> operator*(const MatrixProduct<L, R> &P, const std::array<T,3> &v) {
+	return P.evaluate()*v;
+}
+
+
+template<typename T> //forward declaration
+class UnitQuaternion;
+
+//Rotation matrix: checked once at construction, so applying it to vectors needs no checks
 template<typename T>
-Matrix3<T> operator*( Matrix3<T> const& m1, Matrix3<T> const& m2 ) { 
-    Matrix3<T> result;
-        for(int i=0;i<3;i++) {
-            for(int j=0;j<3;j++) {
-                T sum = 0.0;
-                for(int k=0;k<3;k++) {
-                    sum += m1(i,k)*m2(k,j);
-                }
-                result(i,j) = sum;
-        	}
+class RotationMatrix{
+	private:
+	Matrix3<T> m;
+	constexpr explicit RotationMatrix(const Matrix3<T> &rotation): m{rotation} {} //already checked
+	friend class UnitQuaternion<T>;
+	public:
+	constexpr RotationMatrix(): m{{1, 0, 0, 0, 1, 0, 0, 0, 1}} {} //identity
+	RotationMatrix( RotationMatrix const& ) = default; //copy const
+	RotationMatrix<T>& operator=(RotationMatrix const&) = default;
+
+	//Fails if M is not a rotation matrix
+	static constexpr std::optional<RotationMatrix<T>> fromMatrix(const Matrix3<T> &M) {
+		if(!M.isRotation()){
+			return std::nullopt;
 		}
-	return result;
+		return RotationMatrix<T>(M);
+	}
+
+	constexpr T const& operator[]( int i ) const { //read only
+		return m[i];
+	}
+	constexpr T const& operator()(int i, int j) const { //read only
+		return m(i, j);
+	}
+	constexpr const Matrix3<T>& value() const {
+		return m;
+	}
+
+	//Shepperd's method, normalized: fromMatrix accepts rotations to within the tolerance of isRotation()
+	UnitQuaternion<T> convertToQuaternion() const {
+		return UnitQuaternion<T>::fromQuaternion(m.convertToQuaternion().value()).value();
+	}
+
+	//The inverse of a rotation matrix is its transpose
+	constexpr RotationMatrix<T> inv() const {
+		return RotationMatrix<T>(Matrix3<T>({m(0, 0), m(1, 0), m(2, 0),
+		                                     m(0, 1), m(1, 1), m(2, 1),
+		                                     m(0, 2), m(1, 2), m(2, 2)}));
+	}
+
+	//Rotate a vector. No checks, no branches.
+	constexpr std::array<T,3> apply(const std::array<T,3> &v) const {
+		return {m(0, 0)*v[0] + m(0, 1)*v[1] + m(0, 2)*v[2],
+		        m(1, 0)*v[0] + m(1, 1)*v[1] + m(1, 2)*v[2],
+		        m(2, 0)*v[0] + m(2, 1)*v[1] + m(2, 2)*v[2]};
+	}
+
+	auto cbegin() const {
+		return m.cbegin();
+	}
+	auto cend() const {
+		return m.cend();
+	}
+
+	//composition of rotations is a rotation
+	friend constexpr RotationMatrix<T> operator*(const RotationMatrix<T> &a, const RotationMatrix<T> &b) {
+		return RotationMatrix<T>(detail::multiply(a.m, b.m));
+	}
+};
+
+static_assert(sizeof(RotationMatrix<double>) == sizeof(Matrix3<double>) and std::is_trivially_copyable_v<RotationMatrix<double>>, "RotationMatrix must have the layout of Matrix3");
+
+template<typename T>
+constexpr std::array<T,3> operator*(const RotationMatrix<T> &M, const std::array<T,3> &v) {
+	return M.apply(v);
 }
@@ -0,0 +1,347 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+#include <utility>
+#include <optional>
+#include <random>
+#include <type_traits>
+#include "quaternion.hpp"
+#include "rotationArrays.hpp"
+#include "parallel.hpp"
+#include "mappedFile.hpp"
+
+//Nearest-orientation search over a library of rotations: a vantage-point tree on the unit quaternions, with the
+//distance min(|q - p|, |q + p|) (the chord between q and the nearer of p, -p, so q and -q are the same rotation).
+//It is a metric, a monotonic function of the angle of the rotation between them (chord = 2 sin(angle/4)), and
+//exact to rounding even for close rotations, unlike acos(|q.p|). A query visits O(log n) nodes when the nearest
+//rotations are close; the angles reported are the angles of q^-1 p, in radians, from 0 to pi.
+//The nodes are stored in one array in preorder, so the tree is written to a file and mapped back as it is.
+template<typename T>
+struct OrientationMatch{
+	std::uint32_t index; //position of the rotation in the library
+	T angle;
+};
+
+template<typename T>
+struct OrientationNode{
+	std::array<T,4> q;    //w, x, y, z
+	T radius;             //the nodes in (this, far) are within radius of q, those in [far, end of subtree) are not
+	std::uint32_t index;  //position of q in the library
+	std::uint32_t far;
+};
+
+//64 byte header, then the nodes in native byte order
+struct OrientationFileHeader{
+	char magic[4] = {'R', 'V', 'P', 'T'};
+	std::uint32_t version = 1;
+	std::uint64_t count = 0;       //number of nodes
+	std::uint32_t scalarSize = 8;  //4: float, 8: double
+	std::uint32_t nodeSize = 0;    //sizeof(OrientationNode<T>)
+	std::uint8_t reserved[40] = {};
+
+	template<typename T>
+	bool isValid() const {
+		return std::memcmp(magic, "RVPT", 4) == 0 and version == 1 and scalarSize == sizeof(T)
+		   and nodeSize == sizeof(OrientationNode<T>) and count <= UINT32_MAX;
+	}
+};
+static_assert(sizeof(OrientationFileHeader) == 64, "orientation index file header must be 64 bytes");
+
+namespace detail
+{
+	//min(|a - b|, |a + b|)
+	template<typename T>
+	inline T quaternionChord(const std::array<T,4> &a, const std::array<T,4> &b) {
+		const T sign = a[0]*b[0] + a[1]*b[1] + a[2]*b[2] + a[3]*b[3] < 0 ? T(-1) : T(1);
+		const T w = a[0] - sign*b[0], x = a[1] - sign*b[1], y = a[2] - sign*b[2], z = a[3] - sign*b[3];
+		return std::sqrt(w*w + x*x + y*y + z*z);
+	}
+
+	template<typename T>
+	inline T chordToAngle(T chord) {
+		return 4*std::asin(std::min(chord/2, T(1)/std::sqrt(T(2)))); //at most pi
+	}
+}
+
+template<typename T>
+class OrientationIndex{
+	private:
+	using Node = OrientationNode<T>;
+	static_assert(std::is_trivially_copyable_v<Node>, "the nodes are written to files as they are");
+	std::vector<Node> storage;       //built here, or
+	std::optional<MappedFile> file;  //mapped from a file
+	const Node *nodes = nullptr;     //into storage or file, so a move must take them along and reset them
+	std::size_t count = 0;
+
+	//Nodes [begin, end) hold a subtree: a vantage point is moved to begin, the nearer half of the others follows
+	//it (the radius is their largest distance), the farther half comes after them
+	static void build(Node *nodes, std::size_t begin, std::size_t end, std::minstd_rand &random) {
+		while(end - begin > 1){
+			std::swap(nodes[begin], nodes[begin + random() % (end - begin)]);
+			Node &vantage = nodes[begin];
+			for(std::size_t i = begin + 1; i < end; ++i){
+				nodes[i].radius = detail::quaternionChord(vantage.q, nodes[i].q); //until its own subtree is built
+			}
+			const std::size_t middle = begin + 1 + (end - begin)/2; //the nearer half, rounded up: [begin + 1, middle)
+			auto nearer = [](const Node &a, const Node &b){ return a.radius < b.radius; };
+			std::nth_element(nodes + begin + 1, nodes + middle - 1, nodes + end, nearer);
+			vantage.radius = nodes[middle - 1].radius;
+			vantage.far = static_cast<std::uint32_t>(middle);
+			build(nodes, begin + 1, middle, random);
+			begin = middle;
+		}
+		if(end - begin == 1){
+			nodes[begin].radius = 0;
+			nodes[begin].far = static_cast<std::uint32_t>(end);
+		}
+	}
+
+	//Visits the subtree [begin, end): visit(node, distance) returns the current search radius
+	template<typename F>
+	void search(const std::array<T,4> &q, std::size_t begin, std::size_t end, T &tau, F &visit) const {
+		while(begin < end){
+			const Node &node = nodes[begin];
+			const T d = detail::quaternionChord(q, node.q);
+			tau = visit(node, d);
+			const std::size_t far = node.far; //in (begin, end], checked by open() for mapped files
+			if(d <= node.radius){ //the side of q first, the other while it can hold a point within tau
+				search(q, begin + 1, far, tau, visit);
+				if(!(d + tau >= node.radius)){
+					return;
+				}
+				begin = far;
+			}
+			else{
+				search(q, far, end, tau, visit);
+				if(!(d - tau <= node.radius)){
+					return;
+				}
+				end = far;
+				++begin;
+			}
+		}
+	}
+
+	//The far offsets are those build() writes: then the search stays in the array, and its recursion (one level
+	//per nearer half) is at most log2(count) + 1 deep, whatever a file holds
+	static bool isValidLayout(const Node *nodes, std::size_t count) {
+		std::vector<std::pair<std::size_t, std::size_t>> subtrees{{0, count}};
+		while(!subtrees.empty()){
+			const auto [begin, end] = subtrees.back();
+			subtrees.pop_back();
+			if(begin == end){
+				continue;
+			}
+			const std::size_t far = begin + 1 + (end - begin)/2;
+			if(nodes[begin].far != far){
+				return false;
+			}
+			subtrees.push_back({begin + 1, far});
+			subtrees.push_back({far, end});
+		}
+		return true;
+	}
+
+	static std::array<T,4> components(const UnitQuaternion<T> &q) {
+		return {q.w(), q.x(), q.y(), q.z()};
+	}
+
+	OrientationIndex() = default;
+
+	public:
+	OrientationIndex(OrientationIndex const&) = delete;
+	OrientationIndex& operator=(OrientationIndex const&) = delete;
+	//The moved-from index is left empty
+	OrientationIndex(OrientationIndex &&other) noexcept {
+		*this = std::move(other);
+	}
+	OrientationIndex& operator=(OrientationIndex &&other) noexcept {
+		if(this != &other){
+			storage = std::move(other.storage);
+			file = std::move(other.file);
+			nodes = std::exchange(other.nodes, nullptr);
+			count = std::exchange(other.count, 0);
+			other.storage.clear();
+			other.file.reset();
+		}
+		return *this;
+	}
+
+	//Index over the library; the matches refer to its positions (at most 2^32 - 1 rotations)
+	explicit OrientationIndex(const std::vector<UnitQuaternion<T>> &library) {
+		storage.resize(library.size());
+		for(std::size_t i = 0; i < library.size(); ++i){
+			storage[i] = Node{components(library[i]), T(0), static_cast<std::uint32_t>(i), 0};
+		}
+		std::minstd_rand random(12345); //the same tree for the same library
+		build(storage.data(), 0, storage.size(), random);
+		nodes = storage.data();
+		count = storage.size();
+	}
+
+	//nullopt if a quaternion is not a rotation
+	static std::optional<OrientationIndex<T>> fromArray(const QuaternionArray<T> &library) {
+		std::vector<UnitQuaternion<T>> unit;
+		unit.reserve(library.size());
+		for(std::size_t i = 0; i < library.size(); ++i){
+			if(!library[i].isRotation()){
+				return std::nullopt;
+			}
+			unit.push_back(UnitQuaternion<T>::fromQuaternion(library[i]).value());
+		}
+		return OrientationIndex<T>(unit);
+	}
+
+	//Maps a file written by writeBinary: the queries read the nodes from the mapping. Fails if the file cannot
+	//be read, was written for the other scalar type, is truncated, or its tree is not laid out as build() lays
+	//it out (checked once, reading every node).
+	static std::optional<OrientationIndex<T>> open(const std::string &filename) {
+		auto mapped = MappedFile::open(filename, sizeof(OrientationFileHeader));
+		if(!mapped){
+			return std::nullopt;
+		}
+		OrientationFileHeader head;
+		std::memcpy(&head, mapped->data(), sizeof(head));
+		if(!head.isValid<T>() or (mapped->size() - sizeof(head))/sizeof(Node) < head.count){
+			return std::nullopt;
+		}
+		OrientationIndex<T> index;
+		index.file = std::move(mapped);
+		index.nodes = reinterpret_cast<const Node*>(index.file->data() + sizeof(head));
+		index.count = static_cast<std::size_t>(head.count);
+		if(!isValidLayout(index.nodes, index.count)){
+			return std::nullopt;
+		}
+		return index;
+	}
+
+	//The nodes in preorder, as written to files
+	const Node* data() const {
+		return nodes;
+	}
+	std::size_t size() const {
+		return count;
+	}
+
+	//The k nearest rotations to q (fewer if the library is smaller), nearest first, written to match.
+	//Returns how many. Does not allocate.
+	std::size_t nearest(const UnitQuaternion<T> &q, std::size_t k, OrientationMatch<T> *match) const {
+		std::size_t found = 0;
+		auto farther = [](const OrientationMatch<T> &a, const OrientationMatch<T> &b){ return a.angle < b.angle; };
+		auto visit = [&](const Node &node, T d){ //a max-heap of the k nearest, on the chord until the end
+			if(found < k){
+				match[found++] = {node.index, d};
+				std::push_heap(match, match + found, farther);
+			}
+			else if(d < match[0].angle){
+				std::pop_heap(match, match + k, farther);
+				match[k - 1] = {node.index, d};
+				std::push_heap(match, match + k, farther);
+			}
+			return found < k ? T(2) : match[0].angle; //2: the largest chord
+		};
+		T tau = 2;
+		if(k > 0){
+			search(components(q), 0, count, tau, visit);
+		}
+		std::sort_heap(match, match + found, farther);
+		for(std::size_t i = 0; i < found; ++i){
+			match[i].angle = detail::chordToAngle(match[i].angle);
+		}
+		return found;
+	}
+
+	std::vector<OrientationMatch<T>> nearest(const UnitQuaternion<T> &q, std::size_t k) const {
+		std::vector<OrientationMatch<T>> match(std::min(k, count));
+		nearest(q, k, match.data());
+		return match;
+	}
+
+	//nullopt if the library is empty
+	std::optional<OrientationMatch<T>> nearest(const UnitQuaternion<T> &q) const {
+		if(count == 0){
+			return std::nullopt;
+		}
+		OrientationMatch<T> best{0, T(3)}; //farther than any chord
+		auto visit = [&best](const Node &node, T d){
+			if(d < best.angle){
+				best = {node.index, d};
+			}
+			return best.angle;
+		};
+		T tau = 2;
+		search(components(q), 0, count, tau, visit);
+		best.angle = detail::chordToAngle(best.angle);
+		return best;
+	}
+
+	//All the rotations within angle (radians) of q, nearest first
+	std::vector<OrientationMatch<T>> within(const UnitQuaternion<T> &q, T angle) const {
+		std::vector<OrientationMatch<T>> match;
+		if(!(angle >= 0)){
+			return match;
+		}
+		constexpr T pi = T(3.14159265358979323846);
+		const T radius = angle >= pi ? T(2) : 2*std::sin(angle/4);
+		auto visit = [&](const Node &node, T d){
+			if(d <= radius){
+				match.push_back({node.index, d});
+			}
+			return radius;
+		};
+		T tau = radius;
+		search(components(q), 0, count, tau, visit);
+		std::sort(match.begin(), match.end(), [](const auto &a, const auto &b){ return a.angle < b.angle; });
+		for(auto &m : match){
+			m.angle = detail::chordToAngle(m.angle);
+		}
+		return match;
+	}
+
+	//The k nearest rotations to every query: match[i*k, (i + 1)*k), nearest first, on options.pool.
+	//valid[i] == 1 if query i is a unit quaternion (its matches are meaningless otherwise).
+	//Returns false (and leaves match and valid untouched) if k is 0 or larger than the library.
+	bool nearest(const QuaternionArray<T> &queries, std::size_t k, std::vector<OrientationMatch<T>> &match,
+	             ValidityMask &valid, const ParallelOptions &options = {}) const {
+		if(k == 0 or k > count){
+			return false;
+		}
+		const std::size_t n = queries.size();
+		match.resize(n*k);
+		valid.resize(n);
+		auto body = [&](std::size_t begin, std::size_t end){
+			for(std::size_t i = begin; i < end; ++i){
+				const quaternion<T> q = queries[i];
+				valid[i] = q.isRotation();
+				nearest(valid[i] ? UnitQuaternion<T>::fromQuaternion(q).value() : UnitQuaternion<T>(), k, match.data() + i*k);
+			}
+		};
+		if(options.pool){
+			options.pool->parallelFor(n, options.chunkSize, body);
+		}
+		else{
+			body(0, n);
+		}
+		return true;
+	}
+};
+
+//Writes the nodes as they are, to be mapped back with OrientationIndex<T>::open
+template<typename T>
+bool writeBinary(const OrientationIndex<T> &index, const std::string &filename) {
+	std::ofstream output(filename, std::ios::binary);
+	OrientationFileHeader head;
+	head.count = index.size();
+	head.scalarSize = sizeof(T);
+	head.nodeSize = sizeof(OrientationNode<T>);
+	output.write(reinterpret_cast<const char*>(&head), sizeof(head));
+	output.write(reinterpret_cast<const char*>(index.data()), static_cast<std::streamsize>(index.size()*sizeof(OrientationNode<T>)));
+	return static_cast<bool>(output);
+}
@@ -0,0 +1,156 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <algorithm>
+#include <cstddef>
+
+//Fixed-size pool of worker threads, reused between calls.
+//parallelFor splits [0, n) into chunks; the workers and the calling thread take chunks
+//from a shared counter until none are left, so uneven chunks balance out. An exception thrown by a chunk,
+//on any thread, stops the job and is rethrown on the calling thread once every thread is done with it.
+class ThreadPool{
+	private:
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	//The f of parallelFor, type-erased by hand: std::function would allocate for all but the smallest lambdas
+	void (*job)(void*, std::size_t, std::size_t) = nullptr;
+	void *jobContext = nullptr;
+	std::size_t jobSize = 0;
+	std::size_t jobChunk = 1;
+	std::atomic<std::size_t> nextChunk{0};
+	std::size_t generation = 0;
+	unsigned busy = 0;
+	bool stopping = false;
+	std::exception_ptr failure; //the first exception of the current job
+
+	void runChunks() {
+		const std::size_t chunks = (jobSize + jobChunk - 1) / jobChunk;
+		for(std::size_t c = nextChunk++; c < chunks; c = nextChunk++){
+			const std::size_t begin = c*jobChunk;
+			try{
+				job(jobContext, begin, std::min(jobSize, begin + jobChunk));
+			}
+			catch(...){
+				std::lock_guard<std::mutex> lock(mutex);
+				if(!failure){
+					failure = std::current_exception();
+				}
+				nextChunk = chunks; //the chunks not started yet are skipped
+			}
+		}
+	}
+
+	void workerLoop() {
+		std::size_t seen = 0;
+		while(true){
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [&]{ return stopping or generation != seen; });
+				if(stopping){
+					return;
+				}
+				seen = generation;
+			}
+			runChunks();
+			std::lock_guard<std::mutex> lock(mutex);
+			if(--busy == 0){
+				done.notify_one();
+			}
+		}
+	}
+
+	public:
+	//threads: total number of threads working on a job, including the calling one. 0 means one per core.
+	explicit ThreadPool(unsigned threads = 0) {
+		if(threads == 0){
+			threads = std::max(1u, std::thread::hardware_concurrency());
+		}
+		workers.reserve(threads - 1);
+		for(unsigned i = 1; i < threads; ++i){
+			workers.emplace_back([this]{ workerLoop(); });
+		}
+	}
+	ThreadPool( ThreadPool const& ) = delete;
+	ThreadPool& operator=(ThreadPool const&) = delete;
+	~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for(auto &w : workers){
+			w.join();
+		}
+	}
+
+	unsigned size() const {
+		return static_cast<unsigned>(workers.size()) + 1;
+	}
+
+	//Calls f(begin, end) for consecutive ranges of at most chunk elements covering [0, n). Blocks until done.
+	//If f throws, the remaining chunks are skipped and the first exception is rethrown here, after the workers
+	//have stopped using f. Not reentrant: f must not call parallelFor on the same pool. Does not allocate
+	//(unless f throws).
+	template<typename F>
+	void parallelFor(std::size_t n, std::size_t chunk, F f) {
+		chunk = std::max<std::size_t>(chunk, 1);
+		if(workers.empty() or n <= chunk){
+			for(std::size_t begin = 0; begin < n; begin += chunk){
+				f(begin, std::min(n, begin + chunk));
+			}
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			job = [](void *context, std::size_t begin, std::size_t end){ (*static_cast<F*>(context))(begin, end); };
+			jobContext = &f; //f outlives the job: this call blocks until the workers are done
+			jobSize = n;
+			jobChunk = chunk;
+			nextChunk = 0;
+			busy = static_cast<unsigned>(workers.size());
+			++generation;
+		}
+		wake.notify_all();
+		runChunks();
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [&]{ return busy == 0; });
+		job = nullptr;
+		jobContext = nullptr;
+		if(failure){
+			std::exception_ptr thrown = nullptr;
+			std::swap(thrown, failure);
+			std::rethrow_exception(thrown);
+		}
+	}
+};
+
+//How a batch operation is split across a thread pool
+struct ParallelOptions{
+	ThreadPool *pool = nullptr; //nullptr: run on the calling thread
+	std::size_t chunkSize = 1 << 16; //points per task; large enough to amortize scheduling, small enough to balance
+};
+
+//f(begin, end) summed over [0, n) (R needs +=): in one call without a pool; on options.pool, one partial result
+//per chunk, added in chunk order, so floating-point sums do not depend on the number of threads
+template<typename R, typename F>
+R parallelReduce(std::size_t n, const ParallelOptions &options, F f) {
+	if(!options.pool){
+		return f(std::size_t(0), n);
+	}
+	const std::size_t chunk = std::max<std::size_t>(options.chunkSize, 1);
+	std::vector<R> partial((n + chunk - 1)/chunk);
+	options.pool->parallelFor(n, chunk, [&](std::size_t begin, std::size_t end){
+		partial[begin/chunk] = f(begin, end);
+	});
+	R sum{};
+	for(const R &p : partial){
+		sum += p;
+	}
+	return sum;
+}
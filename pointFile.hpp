@@ -0,0 +1,213 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <optional>
+#include <utility>
+#include <type_traits>
+#include "points.hpp"
+#include "mappedFile.hpp"
+
+//Binary point file:
+//  64 byte header (PointFileHeader), then the coordinates in native byte order, either
+//  interleaved (aos: x0 y0 z0 x1 ...) or as three arrays (soa: x0 x1 ... y0 y1 ... z0 z1 ...).
+//The header size keeps the data cache-line aligned in a mapping, so it can be fed to the kernels directly.
+enum class PointLayout : std::uint32_t { aos = 0, soa = 1 };
+
+struct PointFileHeader{
+	char magic[4] = {'R', 'P', 'T', 'S'};
+	std::uint32_t version = 1;
+	std::uint64_t count = 0; //number of points
+	std::uint32_t scalarSize = 8; //4: float, 8: double
+	PointLayout layout = PointLayout::soa;
+	std::uint8_t reserved[40] = {};
+
+	bool isValid() const {
+		return std::memcmp(magic, "RPTS", 4) == 0 and version == 1
+		   and (scalarSize == 4 or scalarSize == 8) and count <= UINT64_MAX / 24
+		   and (layout == PointLayout::aos or layout == PointLayout::soa);
+	}
+	std::uint64_t dataBytes() const {
+		return 3*count*scalarSize;
+	}
+};
+static_assert(sizeof(PointFileHeader) == 64, "binary point file header must be 64 bytes");
+
+//Read-only view of a binary point file. Uses mmap where available (MappedFile), so opening is O(1)
+//and the coordinates are paged in on first use; otherwise the file is read into memory.
+class MappedPointFile{
+	private:
+	PointFileHeader head;
+	MappedFile bytes;
+
+	explicit MappedPointFile(MappedFile &&bytes): bytes{std::move(bytes)} {}
+
+	template<typename T>
+	const T* data() const {
+		return reinterpret_cast<const T*>(bytes.data() + sizeof(PointFileHeader));
+	}
+
+	public:
+	//Fails if the file cannot be read, the header is invalid or the file is truncated
+	static std::optional<MappedPointFile> open(const std::string &filename) {
+		auto mapped = MappedFile::open(filename, sizeof(PointFileHeader));
+		if(!mapped){
+			return std::nullopt;
+		}
+		MappedPointFile file(std::move(mapped.value()));
+		std::memcpy(&file.head, file.bytes.data(), sizeof(PointFileHeader));
+		if(!file.head.isValid() or file.bytes.size() - sizeof(PointFileHeader) < file.head.dataBytes()){
+			return std::nullopt;
+		}
+		return file;
+	}
+
+	const PointFileHeader& header() const {
+		return head;
+	}
+	std::size_t size() const {
+		return static_cast<std::size_t>(head.count);
+	}
+	PointLayout layout() const {
+		return head.layout;
+	}
+	template<typename T>
+	bool holds() const {
+		return head.scalarSize == sizeof(T);
+	}
+
+	//Zero-copy access to the coordinates. nullptr if the layout or the scalar type does not match.
+	template<typename T>
+	const T* x() const {
+		return holds<T>() and layout() == PointLayout::soa ? data<T>() : nullptr;
+	}
+	template<typename T>
+	const T* y() const {
+		return holds<T>() and layout() == PointLayout::soa ? data<T>() + size() : nullptr;
+	}
+	template<typename T>
+	const T* z() const {
+		return holds<T>() and layout() == PointLayout::soa ? data<T>() + 2*size() : nullptr;
+	}
+	template<typename T>
+	const std::array<T,3>* points() const {
+		static_assert(sizeof(std::array<T,3>) == 3*sizeof(T), "points must be tightly packed");
+		return holds<T>() and layout() == PointLayout::aos ? reinterpret_cast<const std::array<T,3>*>(data<T>()) : nullptr;
+	}
+	//i-th point, for any layout and any stored scalar type
+	template<typename T>
+	std::array<T,3> point(std::size_t i) const {
+		const std::size_t stride = layout() == PointLayout::soa ? size() : 1;
+		const std::size_t first = layout() == PointLayout::soa ? i : 3*i;
+		std::array<T,3> p;
+		for(std::size_t c = 0; c < 3; ++c){
+			p[c] = holds<float>() ? static_cast<T>(data<float>()[first + c*stride])
+			                      : static_cast<T>(data<double>()[first + c*stride]);
+		}
+		return p;
+	}
+};
+
+//Writing: T (float or double) decides the stored scalar type
+template<typename T>
+bool writeBinary(const Points<T> &points, const std::string &filename, PointLayout layout = PointLayout::soa) {
+	static_assert(std::is_same_v<T, float> or std::is_same_v<T, double>, "binary point files hold float or double");
+	std::ofstream output(filename, std::ios::binary);
+	PointFileHeader head;
+	head.count = points.size();
+	head.scalarSize = sizeof(T);
+	head.layout = layout;
+	output.write(reinterpret_cast<const char*>(&head), sizeof(head));
+	const std::size_t n = points.size();
+	if(layout == PointLayout::soa){
+		for(const T *coordinate : {points.x(), points.y(), points.z()}){
+			output.write(reinterpret_cast<const char*>(coordinate), static_cast<std::streamsize>(n*sizeof(T)));
+		}
+	}
+	else{
+		constexpr std::size_t block = 4096;
+		std::vector<T> interleaved(3*block);
+		for(std::size_t start = 0; start < n; start += block){
+			const std::size_t count = std::min(block, n - start);
+			for(std::size_t i = 0; i < count; ++i){
+				interleaved[3*i] = points.x()[start + i];
+				interleaved[3*i + 1] = points.y()[start + i];
+				interleaved[3*i + 2] = points.z()[start + i];
+			}
+			output.write(reinterpret_cast<const char*>(interleaved.data()), static_cast<std::streamsize>(3*count*sizeof(T)));
+		}
+	}
+	return static_cast<bool>(output);
+}
+
+//Reading into a Points container (a copy; converts if the file holds the other scalar type)
+template<typename T>
+Points<T> readBinary(const MappedPointFile &file) {
+	Points<T> points;
+	points.resize(file.size());
+	if(file.x<T>() and file.size() > 0){
+		std::memcpy(points.x(), file.x<T>(), file.size()*sizeof(T));
+		std::memcpy(points.y(), file.y<T>(), file.size()*sizeof(T));
+		std::memcpy(points.z(), file.z<T>(), file.size()*sizeof(T));
+	}
+	else{
+		for(std::size_t i = 0; i < file.size(); ++i){
+			const auto p = file.point<T>(i);
+			points.x()[i] = p[0];
+			points.y()[i] = p[1];
+			points.z()[i] = p[2];
+		}
+	}
+	return points;
+}
+
+template<typename T>
+std::optional<Points<T>> readBinary(const std::string &filename) {
+	auto file = MappedPointFile::open(filename);
+	if(!file){
+		return std::nullopt;
+	}
+	return readBinary<T>(file.value());
+}
+
+//Rotate the points of a file. A file of matching type, soa or aos, is read straight from the mapping by the kernels.
+template<typename T>
+Points<T> rotate(const MappedPointFile &file, const RotationMatrix<T> &M, const ParallelOptions &options = {}) {
+	if(!file.holds<T>()){ //converted to T first
+		Points<T> points = readBinary<T>(file);
+		points.rotateInPlace(M, options);
+		return points;
+	}
+	Points<T> rotated;
+	rotated.resize(file.size());
+	auto kernel = [&](std::size_t begin, std::size_t end){
+		if(file.layout() == PointLayout::soa){
+			simd::rotateSoA(M.value(), file.x<T>() + begin, file.y<T>() + begin, file.z<T>() + begin,
+			                rotated.x() + begin, rotated.y() + begin, rotated.z() + begin, end - begin);
+		}
+		else{
+			simd::rotateAoS(M.value(), file.points<T>() + begin, rotated.x() + begin, rotated.y() + begin, rotated.z() + begin, end - begin);
+		}
+	};
+	if(options.pool){
+		options.pool->parallelFor(file.size(), options.chunkSize, kernel);
+	}
+	else{
+		kernel(0, file.size());
+	}
+	return rotated;
+}
+
+//Converter from the whitespace separated text format (as in ellipse.dat)
+template<typename T = double>
+bool convertTextToBinary(const std::string &textFile, const std::string &binaryFile, PointLayout layout = PointLayout::soa) {
+	std::ifstream input(textFile);
+	if(!input){
+		return false;
+	}
+	return writeBinary(Points<T>(textFile), binaryFile, layout);
+}
@@ -0,0 +1,282 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <future>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <optional>
+#include "matrix.hpp"
+#include "quaternion.hpp"
+#include "axisAngle.hpp"
+#include "kernels.hpp"
+#include "parallel.hpp"
+#include "textFormat.hpp"
+#include "pointFile.hpp"
+
+//Streaming rotation of point files that do not fit in memory.
+//The file is processed in fixed-size chunks with two buffers: while one chunk is rotated, the next one
+//is read and the previous one is written. Peak memory is two chunks, whatever the file size.
+
+struct StreamOptions{
+	std::size_t chunkPoints = 1 << 20; //points per chunk; memory use is 2*3*chunkPoints scalars
+	ParallelOptions parallel; //rotation of each chunk
+};
+
+//Sequential reader of a binary point file (either layout, either scalar type)
+class BinaryPointReader{
+	private:
+	std::ifstream input;
+	PointFileHeader head;
+	std::uint64_t next = 0; //index of the next point
+	std::vector<char> scratch;
+	bool valid = false;
+
+	template<typename S, typename T>
+	static void convertFrom(const char *raw, T *out, std::size_t n, std::size_t stride) {
+		for(std::size_t i = 0; i < n; ++i){
+			S value;
+			std::memcpy(&value, raw + i*stride*sizeof(S), sizeof(S));
+			out[i] = static_cast<T>(value);
+		}
+	}
+
+	template<typename T>
+	void convert(const char *raw, T *out, std::size_t n, std::size_t stride) const {
+		if(head.scalarSize == sizeof(float)){
+			convertFrom<float>(raw, out, n, stride);
+		}
+		else{
+			convertFrom<double>(raw, out, n, stride);
+		}
+	}
+
+	public:
+	explicit BinaryPointReader(const std::string &filename): input(filename, std::ios::binary) {
+		input.read(reinterpret_cast<char*>(&head), sizeof(head));
+		valid = input and head.isValid();
+	}
+
+	bool isOpen() const {
+		return valid;
+	}
+	std::size_t size() const {
+		return static_cast<std::size_t>(head.count);
+	}
+
+	template<typename T>
+	std::size_t read(T *x, T *y, T *z, std::size_t n) {
+		if(!valid){
+			return 0;
+		}
+		n = static_cast<std::size_t>(std::min<std::uint64_t>(n, head.count - next));
+		const std::size_t s = head.scalarSize;
+		if(head.layout == PointLayout::aos){
+			scratch.resize(3*n*s);
+			input.read(scratch.data(), static_cast<std::streamsize>(scratch.size()));
+			convert(scratch.data(), x, n, 3);
+			convert(scratch.data() + s, y, n, 3);
+			convert(scratch.data() + 2*s, z, n, 3);
+		}
+		else{
+			scratch.resize(n*s);
+			T *coordinates[3] = {x, y, z};
+			for(std::uint64_t c = 0; c < 3; ++c){
+				input.seekg(static_cast<std::streamoff>(sizeof(head) + (c*head.count + next)*s));
+				input.read(scratch.data(), static_cast<std::streamsize>(scratch.size()));
+				convert(scratch.data(), coordinates[c], n, 1);
+			}
+		}
+		if(!input){
+			valid = false;
+			return 0;
+		}
+		next += n;
+		return n;
+	}
+};
+
+//Sequential writer of a binary point file with aos layout. The point count is filled in by close().
+template<typename T>
+class BinaryPointWriter{
+	private:
+	std::ofstream output;
+	PointFileHeader head;
+	std::vector<T> interleaved;
+
+	public:
+	explicit BinaryPointWriter(const std::string &filename): output(filename, std::ios::binary) {
+		head.scalarSize = sizeof(T);
+		head.layout = PointLayout::aos;
+		output.write(reinterpret_cast<const char*>(&head), sizeof(head));
+	}
+	BinaryPointWriter( BinaryPointWriter const& ) = delete;
+	BinaryPointWriter& operator=(BinaryPointWriter const&) = delete;
+	~BinaryPointWriter() {
+		close();
+	}
+
+	bool isOpen() const {
+		return output.is_open();
+	}
+
+	void write(const T *x, const T *y, const T *z, std::size_t n) {
+		interleaved.resize(3*n);
+		for(std::size_t i = 0; i < n; ++i){
+			interleaved[3*i] = x[i];
+			interleaved[3*i + 1] = y[i];
+			interleaved[3*i + 2] = z[i];
+		}
+		output.write(reinterpret_cast<const char*>(interleaved.data()), static_cast<std::streamsize>(3*n*sizeof(T)));
+		head.count += n;
+	}
+
+	//Writes the final header. Returns false if writing failed.
+	bool close() {
+		if(!output.is_open()){
+			return false;
+		}
+		output.seekp(0);
+		output.write(reinterpret_cast<const char*>(&head), sizeof(head));
+		bool ok = static_cast<bool>(output);
+		output.close();
+		return ok;
+	}
+};
+
+namespace detail
+{
+	//The rotations main.cpp uses, checked once and converted to a matrix
+	template<typename T>
+	std::optional<RotationMatrix<T>> toRotationMatrix(const RotationMatrix<T> &M) {
+		return M;
+	}
+	template<typename T>
+	std::optional<RotationMatrix<T>> toRotationMatrix(const UnitQuaternion<T> &q) {
+		return q.convertToMatrix();
+	}
+	template<typename T>
+	std::optional<RotationMatrix<T>> toRotationMatrix(const Matrix3<T> &M) {
+		return RotationMatrix<T>::fromMatrix(M);
+	}
+	template<typename T>
+	std::optional<RotationMatrix<T>> toRotationMatrix(const quaternion<T> &q) {
+		if(!q.isRotation()){
+			return std::nullopt;
+		}
+		return UnitQuaternion<T>::fromQuaternion(q).value().convertToMatrix();
+	}
+	template<typename T>
+	std::optional<RotationMatrix<T>> toRotationMatrix(const axisAngle<T> &a) {
+		auto M = a.convertToMatrix();
+		return M ? RotationMatrix<T>::fromMatrix(M.value()) : std::nullopt;
+	}
+	template<typename R>
+	auto toRotationMatrix(const std::optional<R> &rotation) -> decltype(toRotationMatrix(rotation.value())) {
+		return rotation ? toRotationMatrix(rotation.value()) : std::nullopt;
+	}
+
+	template<typename T>
+	struct Chunk{
+		std::vector<T> x, y, z;
+		std::size_t size = 0;
+		explicit Chunk(std::size_t capacity): x(capacity), y(capacity), z(capacity) {}
+	};
+}
+
+//Rotate every point of source into sink, chunk by chunk.
+//Source: read(x, y, z, n) -> number of points read (0 at the end). Sink: write(x, y, z, n).
+//Returns the number of points processed.
+template<typename T, typename Source, typename Sink>
+std::size_t streamRotate(Source &source, Sink &sink, const RotationMatrix<T> &M, const StreamOptions &options = {}) {
+	const std::size_t capacity = std::max<std::size_t>(options.chunkPoints, 1);
+	detail::Chunk<T> chunks[2] = {detail::Chunk<T>(capacity), detail::Chunk<T>(capacity)};
+	auto readInto = [&](detail::Chunk<T> &chunk){
+		chunk.size = source.read(chunk.x.data(), chunk.y.data(), chunk.z.data(), capacity);
+	};
+	auto rotate = [&](detail::Chunk<T> &chunk, std::size_t begin, std::size_t end){
+		simd::rotateSoA(M.value(), chunk.x.data() + begin, chunk.y.data() + begin, chunk.z.data() + begin,
+		                chunk.x.data() + begin, chunk.y.data() + begin, chunk.z.data() + begin, end - begin);
+	};
+
+	std::size_t total = 0;
+	std::future<void> reading = std::async(std::launch::async, readInto, std::ref(chunks[0]));
+	std::future<void> writing;
+	for(int current = 0; ; current ^= 1){
+		reading.get();
+		detail::Chunk<T> &chunk = chunks[current];
+		if(chunk.size == 0){
+			break;
+		}
+		if(writing.valid()){
+			writing.get(); //the other buffer is free again
+		}
+		reading = std::async(std::launch::async, readInto, std::ref(chunks[current ^ 1]));
+		if(options.parallel.pool){
+			options.parallel.pool->parallelFor(chunk.size, options.parallel.chunkSize, [&](std::size_t begin, std::size_t end){
+				rotate(chunk, begin, end);
+			});
+		}
+		else{
+			rotate(chunk, 0, chunk.size);
+		}
+		total += chunk.size;
+		writing = std::async(std::launch::async, [&sink, &chunk]{
+			sink.write(chunk.x.data(), chunk.y.data(), chunk.z.data(), chunk.size);
+		});
+	}
+	if(writing.valid()){
+		writing.get();
+	}
+	return total;
+}
+
+//Text file to text file (the format of ellipse.dat). Rotation: anything main.cpp uses (quaternion, Matrix3,
+//axisAngle, optionally wrapped in std::optional) or a validated rotation.
+//Returns the number of points, or nullopt if a file cannot be opened or the rotation is not valid.
+template<typename T = double, typename R>
+std::optional<std::size_t> rotateTextFile(const std::string &input, const std::string &output, const R &rotation,
+                                          const StreamOptions &options = {}) {
+	std::optional<RotationMatrix<T>> M = detail::toRotationMatrix(rotation);
+	if(!M){
+		return std::nullopt;
+	}
+	TextPointReader source(input);
+	if(!source.isOpen()){
+		return std::nullopt;
+	}
+	TextPointWriter sink(output); //only now: opening truncates the output
+	if(!sink.isOpen()){
+		return std::nullopt;
+	}
+	std::size_t n = streamRotate(source, sink, M.value(), options);
+	if(!sink.flush()){
+		return std::nullopt;
+	}
+	return n;
+}
+
+//Binary point file to binary point file (aos layout, scalar type T)
+template<typename T = double, typename R>
+std::optional<std::size_t> rotateBinaryFile(const std::string &input, const std::string &output, const R &rotation,
+                                            const StreamOptions &options = {}) {
+	std::optional<RotationMatrix<T>> M = detail::toRotationMatrix(rotation);
+	if(!M){
+		return std::nullopt;
+	}
+	BinaryPointReader source(input);
+	if(!source.isOpen()){
+		return std::nullopt;
+	}
+	BinaryPointWriter<T> sink(output); //only now: opening truncates the output
+	if(!sink.isOpen()){
+		return std::nullopt;
+	}
+	std::size_t n = streamRotate(source, sink, M.value(), options);
+	if(!sink.close() or n != source.size()){
+		return std::nullopt;
+	}
+	return n;
+}
@@ -0,0 +1,246 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <cstddef>
+#include <optional>
+#include <memory_resource>
+#include "matrix.hpp"
+#include "quaternion.hpp"
+#include "rigidTransform.hpp"
+#include "kernels.hpp"
+#include "parallel.hpp"
+#include "textFormat.hpp"
+
+//Point cloud, stored as three contiguous coordinate arrays (structure of arrays).
+//The arrays are allocated from a std::pmr::memory_resource: the default heap, or an arena given at construction
+//(e.g. a std::pmr::monotonic_buffer_resource released once per frame). A copy is made on the default heap.
+template<typename T = double>
+class Points{
+	private:
+	std::pmr::vector<T> xs;
+	std::pmr::vector<T> ys;
+	std::pmr::vector<T> zs;
+	public:
+	Points(): xs{}, ys{}, zs{} {};
+	explicit Points(std::pmr::memory_resource *resource): xs(resource), ys(resource), zs(resource) {} //empty, allocating from resource
+	Points(const std::vector<std::array<T,3>> &d) { //construct from a list of points
+		reserve(d.size());
+		for(const auto &e : d){
+			push_back(e);
+		}
+	}
+	Points(const std::string & filename) { //construct from a text file, three numbers per point
+		TextPointReader reader(filename);
+		constexpr std::size_t block = 1 << 14;
+		std::size_t n = 0;
+		while(reader.isOpen()){
+			resize(n + block);
+			std::size_t got = reader.read(x() + n, y() + n, z() + n, block);
+			n += got;
+			if(got < block){
+				break;
+			}
+		}
+		resize(n);
+	}
+
+	std::size_t size() const {
+		return xs.size();
+	}
+	std::size_t capacity() const {
+		return std::min({xs.capacity(), ys.capacity(), zs.capacity()});
+	}
+	std::pmr::memory_resource* resource() const {
+		return xs.get_allocator().resource();
+	}
+	void reserve(std::size_t n) {
+		xs.reserve(n);
+		ys.reserve(n);
+		zs.reserve(n);
+	}
+	void resize(std::size_t n) {
+		xs.resize(n);
+		ys.resize(n);
+		zs.resize(n);
+	}
+	void push_back(const std::array<T,3> &p) {
+		xs.push_back(p[0]);
+		ys.push_back(p[1]);
+		zs.push_back(p[2]);
+	}
+	std::array<T,3> operator[](std::size_t i) const { //read only, a point is not stored contiguously
+		return {xs[i], ys[i], zs[i]};
+	}
+
+	//Raw coordinate arrays, for use with batch kernels
+	T* x() {
+		return xs.data();
+	}
+	T* y() {
+		return ys.data();
+	}
+	T* z() {
+		return zs.data();
+	}
+	const T* x() const {
+		return xs.data();
+	}
+	const T* y() const {
+		return ys.data();
+	}
+	const T* z() const {
+		return zs.data();
+	}
+
+	//Batch rotation with an already validated rotation: converted to a matrix once, applied with no checks.
+	//With options.pool set, the points are split into chunks rotated in parallel; the result is identical to the serial one.
+	Points rotate(const UnitQuaternion<T> &q, const ParallelOptions &options = {}) const {
+		return rotate(q.convertToMatrix(), options);
+	}
+
+	Points rotate(const RotationMatrix<T> &M, const ParallelOptions &options = {}) const {
+		Points rotated(resource());
+		rotate(M, rotated, options);
+		return rotated;
+	}
+
+	//Untrusted input: the rotation is checked once. If it is not a rotation, the result is empty.
+	Points rotate(const std::optional<quaternion<T>> &q, const ParallelOptions &options = {}) const {
+		if(!q or !q.value().isRotation()){
+			return Points();
+		}
+		return rotate(UnitQuaternion<T>::fromQuaternion(q.value()).value(), options);
+	}
+
+	Points rotate(const std::optional<Matrix3<T>> &M, const ParallelOptions &options = {}) const {
+		auto checked = M ? RotationMatrix<T>::fromMatrix(M.value()) : std::nullopt;
+		if(!checked){
+			return Points();
+		}
+		return rotate(checked.value(), options);
+	}
+
+	//Into caller-provided points, resized to size(): no allocation once out has the capacity. out may be *this.
+	void rotate(const UnitQuaternion<T> &q, Points &out, const ParallelOptions &options = {}) const {
+		rotate(q.convertToMatrix(), out, options);
+	}
+
+	void rotate(const RotationMatrix<T> &M, Points &out, const ParallelOptions &options = {}) const {
+		out.resize(size());
+		rotateInto(M, out, options);
+	}
+
+	//Return false (and leave out untouched) if not a rotation.
+	bool rotate(const quaternion<T> &q, Points &out, const ParallelOptions &options = {}) const {
+		if(!q.isRotation()){
+			return false;
+		}
+		rotate(UnitQuaternion<T>::fromQuaternion(q).value(), out, options);
+		return true;
+	}
+
+	bool rotate(const Matrix3<T> &M, Points &out, const ParallelOptions &options = {}) const {
+		auto checked = RotationMatrix<T>::fromMatrix(M);
+		if(!checked){
+			return false;
+		}
+		rotate(checked.value(), out, options);
+		return true;
+	}
+
+	//In-place variants, no allocation
+	void rotateInPlace(const UnitQuaternion<T> &q, const ParallelOptions &options = {}) {
+		rotateInPlace(q.convertToMatrix(), options);
+	}
+
+	void rotateInPlace(const RotationMatrix<T> &M, const ParallelOptions &options = {}) {
+		rotateInto(M, *this, options);
+	}
+
+	//Return false (and leave the points untouched) if not a rotation.
+	bool rotateInPlace(const quaternion<T> &q, const ParallelOptions &options = {}) {
+		if(!q.isRotation()){
+			return false;
+		}
+		rotateInPlace(UnitQuaternion<T>::fromQuaternion(q).value(), options);
+		return true;
+	}
+
+	bool rotateInPlace(const Matrix3<T> &M, const ParallelOptions &options = {}) {
+		auto checked = RotationMatrix<T>::fromMatrix(M);
+		if(!checked){
+			return false;
+		}
+		rotateInPlace(checked.value(), options);
+		return true;
+	}
+
+	//Rigid transforms, R p + t: one pass over the points. out is resized; it may be *this.
+	Points transform(const RigidTransform<T> &X, const ParallelOptions &options = {}) const {
+		Points moved(resource());
+		transform(X, moved, options);
+		return moved;
+	}
+
+	void transform(const RigidTransform<T> &X, Points &out, const ParallelOptions &options = {}) const {
+		out.resize(size());
+		transformInto(X.matrix().value(), {0, 0, 0}, X.translation(), out, options);
+	}
+
+	void transformInPlace(const RigidTransform<T> &X, const ParallelOptions &options = {}) {
+		transformInto(X.matrix().value(), {0, 0, 0}, X.translation(), *this, options);
+	}
+
+	//R (p - pivot) + pivot + translation: centering, rotation and translation in the same pass (e.g. pivot = centroid())
+	void rotateAbout(const RotationMatrix<T> &R, const std::array<T,3> &pivot, const std::array<T,3> &translation,
+	                 Points &out, const ParallelOptions &options = {}) const {
+		out.resize(size());
+		transformInto(R.value(), pivot, {pivot[0] + translation[0], pivot[1] + translation[1], pivot[2] + translation[2]}, out, options);
+	}
+
+	//Mean of the points (accumulated in double at least), 0 if empty
+	std::array<T,3> centroid() const {
+		using Sum = decltype(T() + 0.);
+		Sum sx = 0, sy = 0, sz = 0;
+		for(std::size_t i = 0; i < size(); ++i){
+			sx += xs[i];
+			sy += ys[i];
+			sz += zs[i];
+		}
+		const Sum n = size() > 0 ? static_cast<Sum>(size()) : Sum(1);
+		return {static_cast<T>(sx/n), static_cast<T>(sy/n), static_cast<T>(sz/n)};
+	}
+
+	//Text file, three numbers per point, shortest representation that reads back exactly
+	void writeToFile(const std::string & filename) const {
+		TextPointWriter output(filename);
+		output.write(x(), y(), z(), size());
+	}
+
+	private:
+	//out must have the same size; out == *this is allowed
+	void rotateInto(const RotationMatrix<T> &M, Points &out, const ParallelOptions &options) const {
+		if(!options.pool){
+			simd::rotateSoA(M.value(), x(), y(), z(), out.x(), out.y(), out.z(), size());
+			return;
+		}
+		options.pool->parallelFor(size(), options.chunkSize, [&](std::size_t begin, std::size_t end){
+			simd::rotateSoA(M.value(), x() + begin, y() + begin, z() + begin,
+			                out.x() + begin, out.y() + begin, out.z() + begin, end - begin);
+		});
+	}
+
+	//out = M (p - center) + offset; out must have the same size, out == *this is allowed
+	void transformInto(const Matrix3<T> &M, const std::array<T,3> &center, const std::array<T,3> &offset, Points &out, const ParallelOptions &options) const {
+		if(!options.pool){
+			simd::transformSoA(M, center, offset, x(), y(), z(), out.x(), out.y(), out.z(), size());
+			return;
+		}
+		options.pool->parallelFor(size(), options.chunkSize, [&](std::size_t begin, std::size_t end){
+			simd::transformSoA(M, center, offset, x() + begin, y() + begin, z() + begin,
+			                   out.x() + begin, out.y() + begin, out.z() + begin, end - begin);
+		});
+	}
+};
@@ -0,0 +1,17 @@
+#pragma once
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+
+//Precision of the scalar type T, so that the classes run in float as well as in double
+namespace detail
+{
+	//Type of norms, angles and other derived real numbers: T itself for float and double, double for integer T
+	template<typename T>
+	using Real = std::conditional_t<std::is_floating_point_v<T>, T, double>;
+
+	//Tolerance of the isRotation() checks: 1e-6, or 32 rounding errors of T where that is larger
+	//(float: 3.8e-6, so that rotations computed in float pass)
+	template<typename T>
+	constexpr Real<T> rotationTolerance = static_cast<Real<T>>(std::max(1e-6, 32.*static_cast<double>(std::numeric_limits<Real<T>>::epsilon())));
+}
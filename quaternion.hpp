@@ -5,6 +5,10 @@
 #include <numeric>
 #include <initializer_list>
 #include <cmath>
+#include <optional>
+#include <limits>
+#include "precision.hpp"
+#include "fastMath.hpp"
 #include "matrix.hpp"
 #include "axisAngle.hpp"
 //Helper functions:
@@ -20,6 +24,27 @@ namespace detail
 	{
 		std::transform(v1.cbegin(), v1.cend(), v2.begin(), f);
 	}
+
+	//sqrt usable in constant expressions: Newton's iteration at compile time, std::sqrt at run time
+	template<typename T>
+	constexpr T sqrt(T v) {
+#if defined(__GNUC__) || defined(__clang__) || (defined(_MSC_VER) && _MSC_VER >= 1925)
+		if(!__builtin_is_constant_evaluated()){
+			return std::sqrt(v);
+		}
+#endif
+		if(!(v > 0) or !(v <= std::numeric_limits<T>::max())){ //0, negative, infinite or NaN
+			return v == 0 or v > 0 ? v : std::numeric_limits<T>::quiet_NaN();
+		}
+		T x = v > 1 ? v : T(1); //above the root: the iteration decreases monotonically
+		while(true){
+			T next = (x + v/x)/2;
+			if(!(next < x)){
+				return x;
+			}
+			x = next;
+		}
+	}
 }
 
 //Common lambdas:
@@ -35,14 +60,14 @@ class quaternion{
 	private: 
 	std::array<T,4> data;
 	public:
-	quaternion(): data{{static_cast<T>(0.), static_cast<T>(0.), static_cast<T>(0.), static_cast<T>(0.)}} {} //default const 
+	constexpr quaternion(): data{{static_cast<T>(0.), static_cast<T>(0.), static_cast<T>(0.), static_cast<T>(0.)}} {} //default const 
     /**
 	*  Constructor
     */
-	quaternion(std::array<T,3> arr): data{arr}{} //init. list from vector 
-	quaternion(T _s, T _v1, T _v2, T _v3): data{{_s, _v1, _v2, _v3}}{} //init. list from 4 numbers
+	constexpr quaternion(std::array<T,3> arr): data{arr}{} //init. list from vector 
+	constexpr quaternion(T _s, T _v1, T _v2, T _v3): data{{_s, _v1, _v2, _v3}}{} //init. list from 4 numbers
 
-	quaternion(T _s, std::array<T,3> _v): data{{_s, _v[0], _v[1], _v[2]}}{} //init. list from scalar + vector
+	constexpr quaternion(T _s, std::array<T,3> _v): data{{_s, _v[0], _v[1], _v[2]}}{} //init. list from scalar + vector
 	quaternion( quaternion const& ) = default; //copy const       
 
 	
@@ -50,20 +75,20 @@ class quaternion{
 
 	//begin and end for compatibility with STL:
 	//get components:
-	T x() const {
+	constexpr T x() const {
 		return data[1];
 	}
-	T y() const {
+	constexpr T y() const {
 		return data[2];
 	}
-	T z() const {
+	constexpr T z() const {
 		return data[3];
 	} 
-	T w() const {
+	constexpr T w() const {
 		return data[0];
 	}
 	// Get vector part 
-	std::array<T,3> vectorPart() const{
+	constexpr std::array<T,3> vectorPart() const{
 		return {x(), y(), z()};
 	}
 
@@ -83,27 +108,29 @@ class quaternion{
 	}
 	//Conversion functions: (matrix, axis-angle)
 	//Matrix conversion is always valid, but the result is not necessarily a rotation matrix
-	Matrix3<T> convertToMatrix() const {
-		T a11 = -1. + 2*sq(x()) + 2*sq(w()); T a12 = 2*(x()*y() - z()*w());       T a13 = 2*(x()*z() + y()*w());
-		T a21 = 2*(x()*y() + z()*w());       T a22 = -1. + 2*sq(y()) + 2*sq(w()); T a23 = 2*(y()*z() - x()*w()); 
-		T a31 = 2*(x()*z() - y()*w());       T a32 = 2*(x()*w() + y()*z());       T a33 = -1. + 2*sq(z()) + 2*sq(w());
+	constexpr Matrix3<T> convertToMatrix() const {
+		T a11 = T(-1) + 2*x()*x() + 2*w()*w(); T a12 = 2*(x()*y() - z()*w());         T a13 = 2*(x()*z() + y()*w());
+		T a21 = 2*(x()*y() + z()*w());         T a22 = T(-1) + 2*y()*y() + 2*w()*w(); T a23 = 2*(y()*z() - x()*w()); 
+		T a31 = 2*(x()*z() - y()*w());         T a32 = 2*(x()*w() + y()*z());         T a33 = T(-1) + 2*z()*z() + 2*w()*w();
 		Matrix3<T> result({a11, a12, a13, a21, a22, a23, a31, a32, a33});
 		return result;
 	}
 
 	//conversion to axis-angle representation is only valid when the quaternion is unitary
 	//for numerical stability, atan2 function is used
+	//Trig: StdTrig or FastTrig, see fastMath.hpp
+	template<typename Trig = StdTrig>
 	std::optional<axisAngle<T>> convertToAxisAngle() const {
 		if(!isRotation()){
 			return std::nullopt;
 		}
 		else{
 			std::array<T,3> axis;
-			T alpha = 2*std::atan2(1, w());
-			if(alpha == 0){
-				axis = {0., 0., 0.};
+			T s = std::sqrt(x()*x() + y()*y() + z()*z()); //sin(alpha/2): no sin call, and accurate for small angles
+			T alpha = 2*Trig::atan2(s, w());
+			if(s == 0){
+				axis = {T(0), T(0), T(0)};
 			}else{
-				T s = std::sin(alpha/2.);
 				axis = {x()/s, y()/s, z()/s};
 			}
 			axisAngle<T> result {axis, alpha};
@@ -111,40 +138,41 @@ class quaternion{
 		}
 	}
 	
-	quaternion<T> inv() const {
+	constexpr quaternion<T> inv() const {
 		return {w(), -x(), -y(), -z()};
 	}
 
-	double norm() const { 
-		return std::sqrt(std::inner_product(data.begin(), data.end(), data.begin(), 0.));
+	//T for float and double, double for integer T
+	detail::Real<T> norm() const { 
+		return std::sqrt(std::inner_product(data.begin(), data.end(), data.begin(), detail::Real<T>(0)));
 	}
 	
 	bool isRotation() const {
-		return (std::abs(norm() - 1.) < 1e-6);
+		return (std::abs(norm() - 1) < detail::rotationTolerance<T>);
 	}
 };
 
 //scalar multiply, to normalize quaternion
 template<typename T>
 quaternion<T> operator*( T s, const quaternion<T> & a){
-	quaternion<T> result ();
+	quaternion<T> result;
 	detail::transform_quaternion1(a, result, [s](T x){return s*x;});
 	return result;
 }
 template<typename T>
 quaternion<T> operator*( const quaternion<T> & a, T s){
-	quaternion<T> result ();
+	quaternion<T> result;
 	detail::transform_quaternion1(a, result, [s](T x){return x*s;});
 	return result;
 }
 template<typename T>
 quaternion<T> operator/( const quaternion<T> & a, T s){
-	quaternion<T> result ();
+	quaternion<T> result;
 	detail::transform_quaternion1(a, result, [s](T x){return x/s;});
 	return result;
 }
 template<typename T>
-quaternion<T> operator*(const quaternion<T> & a, const quaternion<T> & b){
+constexpr quaternion<T> operator*(const quaternion<T> & a, const quaternion<T> & b){
 	T tw = a.w()*b.w() - a.x()*b.x() - a.y()*b.y() - a.z()*b.z();
 	T tx = a.w()*b.x() + a.x()*b.w() + a.y()*b.z() - a.z()*b.y();
 	T ty = a.w()*b.y() - a.x()*b.z() + a.y()*b.w() + a.z()*b.x();
@@ -152,14 +180,90 @@ quaternion<T> operator*(const quaternion<T> & a, const quaternion<T> & b){
 	return {tw, tx, ty, tz};
 }
 
+namespace detail
+{
+	//q r q^-1 for a unit quaternion q = (w, u): r + w t + u x t, with t = 2 u x r. 18 multiplies, against 32
+	//for the two Hamilton products, and no temporary quaternions.
+	template<typename T>
+	constexpr std::array<T,3> rotateByUnitQuaternion(const quaternion<T> &q, const std::array<T,3> &r) {
+		const T tx = 2*(q.y()*r[2] - q.z()*r[1]);
+		const T ty = 2*(q.z()*r[0] - q.x()*r[2]);
+		const T tz = 2*(q.x()*r[1] - q.y()*r[0]);
+		return {r[0] + q.w()*tx + (q.y()*tz - q.z()*ty),
+		        r[1] + q.w()*ty + (q.z()*tx - q.x()*tz),
+		        r[2] + q.w()*tz + (q.x()*ty - q.y()*tx)};
+	}
+}
+
 template<typename T>
 std::optional<std::array<T,3>> rotateByQuaternion(const quaternion<T> &q, const std::array<T,3> &r) {
 	if(!q.isRotation()){
 		return std::nullopt;
 	}
 	else {
-		quaternion<T> Rquat(0., r); 
-		quaternion<T> RquatPrime = q*Rquat*q.inv();
-		return RquatPrime.vectorPart();
+		return detail::rotateByUnitQuaternion(q, r);
+	}
+}
+
+template<typename T> //forward declaration
+class RotationMatrix;
+
+//Unit quaternion: normalized once at construction, so applying it to vectors needs no checks
+template<typename T>
+class UnitQuaternion{
+	private:
+	quaternion<T> q;
+	constexpr explicit UnitQuaternion(const quaternion<T> &unit): q{unit} {} //already normalized
+	public:
+	constexpr UnitQuaternion(): q{1, 0, 0, 0} {} //identity
+	UnitQuaternion( UnitQuaternion const& ) = default; //copy const
+	UnitQuaternion<T>& operator=(UnitQuaternion const&) = default;
+
+	//Normalizes q, fails for the zero quaternion (or a non-finite one). Usable in constant expressions.
+	static constexpr std::optional<UnitQuaternion<T>> fromQuaternion(const quaternion<T> &q) {
+		T n = detail::sqrt(q.w()*q.w() + q.x()*q.x() + q.y()*q.y() + q.z()*q.z());
+		if(!(n > 0) or !(n <= std::numeric_limits<T>::max())){ //also false for NaN
+			return std::nullopt;
+		}
+		return UnitQuaternion<T>({q.w()/n, q.x()/n, q.y()/n, q.z()/n});
+	}
+
+	constexpr T x() const {
+		return q.x();
+	}
+	constexpr T y() const {
+		return q.y();
+	}
+	constexpr T z() const {
+		return q.z();
+	}
+	constexpr T w() const {
+		return q.w();
+	}
+	constexpr const quaternion<T>& value() const {
+		return q;
+	}
+
+	constexpr UnitQuaternion<T> inv() const {
+		return UnitQuaternion<T>(q.inv());
 	}
+
+	constexpr RotationMatrix<T> convertToMatrix() const {
+		return RotationMatrix<T>(q.convertToMatrix());
+	}
+
+	//Rotate a vector: v' = v + w t + u x t, with t = 2 u x v (u is the vector part). No checks, no branches.
+	constexpr std::array<T,3> apply(const std::array<T,3> &v) const {
+		return detail::rotateByUnitQuaternion(q, v);
+	}
+
+	//composition of unit quaternions is a unit quaternion (up to rounding)
+	friend constexpr UnitQuaternion<T> operator*(const UnitQuaternion<T> &a, const UnitQuaternion<T> &b) {
+		return UnitQuaternion<T>(a.q*b.q);
+	}
+};
+
+template<typename T>
+constexpr std::array<T,3> operator*(const UnitQuaternion<T> &q, const std::array<T,3> &v) {
+	return q.apply(v);
 }
\ No newline at end of file
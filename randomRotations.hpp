@@ -0,0 +1,129 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include "quaternion.hpp"
+#include "rotationArrays.hpp"
+#include "parallel.hpp"
+#include "fastMath.hpp"
+#include "batchConversion.hpp"
+
+//Uniformly distributed random rotations (the Haar measure on SO(3)), by Shoemake's subgroup algorithm: from three
+//uniforms u1, u2, u3 in [0, 1), q = (sqrt(u1) cos 2 pi u3, sqrt(1 - u1) sin 2 pi u2, sqrt(1 - u1) cos 2 pi u2, sqrt(u1) sin 2 pi u3).
+//The angles are taken shifted to [-pi, pi), 2 pi (u - 1/2), where the range reduction of the sine is exact. That
+//flips the signs of every sine and cosine, so the quaternions are the negatives of the textbook ones: the same
+//rotations, with the opposite sign.
+//The uniforms come from Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3"), a
+//counter-based generator: rotation i of a sequence is a function of the seed and i alone. Any range of the
+//sequence is generated on its own, the loop carries no state between iterations (so it vectorizes), and the
+//rotations are the same whatever the number of threads that generate them.
+namespace detail
+{
+	//Philox4x32 with 10 rounds: the counter c0..c3 is replaced by its random image under the key (k0, k1)
+	inline void philox4x32(std::uint32_t &c0, std::uint32_t &c1, std::uint32_t &c2, std::uint32_t &c3, std::uint32_t k0, std::uint32_t k1) {
+		for(int round = 0; round < 10; ++round){
+			const std::uint64_t p0 = std::uint64_t(0xD2511F53u)*c0, p1 = std::uint64_t(0xCD9E8D57u)*c2;
+			const std::uint32_t hi0 = static_cast<std::uint32_t>(p0 >> 32), lo0 = static_cast<std::uint32_t>(p0);
+			const std::uint32_t hi1 = static_cast<std::uint32_t>(p1 >> 32), lo1 = static_cast<std::uint32_t>(p1);
+			c0 = hi1 ^ c1 ^ k0;
+			c1 = lo1;
+			c2 = hi0 ^ c3 ^ k1;
+			c3 = lo0;
+			k0 += 0x9E3779B9u;
+			k1 += 0xBB67AE85u;
+		}
+	}
+
+	//[0, 1) from random bits, put in the mantissa of a number in [1, 2): 52 bits for double, 23 for float
+	inline double unitInterval(std::uint32_t high, std::uint32_t low) {
+		const std::uint64_t bits = ((std::uint64_t(high) << 32 | low) >> 12) | 0x3FF0000000000000u;
+		double u;
+		std::memcpy(&u, &bits, sizeof(u));
+		return u - 1.;
+	}
+	inline float unitInterval(std::uint32_t high) {
+		const std::uint32_t bits = (high >> 9) | 0x3F800000u;
+		float u;
+		std::memcpy(&u, &bits, sizeof(u));
+		return u - 1.f;
+	}
+
+	//Rotation index of the sequence seed: one Philox block (counter: index, 0) gives the three uniforms of a
+	//float rotation, double takes the second block (index, 1) for the third
+	template<typename T>
+	inline void uniformQuaternion(std::uint64_t seed, std::uint64_t index, T &w, T &x, T &y, T &z) {
+		static_assert(std::is_same_v<T, float> or std::is_same_v<T, double>, "random rotations are float or double");
+		const std::uint32_t k0 = static_cast<std::uint32_t>(seed), k1 = static_cast<std::uint32_t>(seed >> 32);
+		const std::uint32_t i0 = static_cast<std::uint32_t>(index), i1 = static_cast<std::uint32_t>(index >> 32);
+		std::uint32_t a0 = i0, a1 = i1, a2 = 0, a3 = 0;
+		philox4x32(a0, a1, a2, a3, k0, k1);
+		T u1, u2, u3;
+		if constexpr(std::is_same_v<T, float>){
+			u1 = unitInterval(a0);
+			u2 = unitInterval(a1);
+			u3 = unitInterval(a2);
+		}
+		else{
+			std::uint32_t b0 = i0, b1 = i1, b2 = 1, b3 = 0;
+			philox4x32(b0, b1, b2, b3, k0, k1);
+			u1 = unitInterval(a0, a1);
+			u2 = unitInterval(a2, a3);
+			u3 = unitInterval(b0, b1);
+		}
+		const T r1 = std::sqrt(T(1) - u1), r2 = std::sqrt(u1);
+		T s2, c2, s3, c3;
+		constexpr T twoPi = T(6.283185307179586476925);
+		fastmath::sincos(twoPi*(u2 - T(0.5)), s2, c2); //angles in [-pi, pi), where the range reduction is exact
+		fastmath::sincos(twoPi*(u3 - T(0.5)), s3, c3);
+		w = r2*c3;
+		x = r1*s2;
+		y = r1*c2;
+		z = r2*s3;
+	}
+}
+
+//Rotation index of the random sequence seed: the same as element i of batch::uniformRotations(seed, first, ...)
+//for first + i == index
+template<typename T>
+UnitQuaternion<T> uniformRotation(std::uint64_t seed, std::uint64_t index) {
+	T w, x, y, z;
+	detail::uniformQuaternion(seed, index, w, x, y, z);
+	return UnitQuaternion<T>::fromQuaternion({w, x, y, z}).value();
+}
+
+namespace batch
+{
+	//q[i] = rotation first + i of the random sequence seed, for i in [0, n) (q is resized to n)
+	template<typename T>
+	void uniformRotations(std::uint64_t seed, std::uint64_t first, std::size_t n, QuaternionArray<T> &q, const ParallelOptions &options = {}) {
+		q.resize(n);
+		T *qw = q.w(), *qx = q.x(), *qy = q.y(), *qz = q.z();
+		detail::forChunks(n, options, [=](std::size_t begin, std::size_t end){
+			detail::forEach(end - begin, [=](std::size_t j){
+				const std::size_t i = begin + j;
+				::detail::uniformQuaternion(seed, first + i, qw[i], qx[i], qy[i], qz[i]);
+			});
+		});
+	}
+
+	//The same rotations as matrices (M is resized to n)
+	template<typename T>
+	void uniformRotations(std::uint64_t seed, std::uint64_t first, std::size_t n, MatrixArray<T> &M, const ParallelOptions &options = {}) {
+		M.resize(n);
+		T *m00 = M(0, 0), *m01 = M(0, 1), *m02 = M(0, 2);
+		T *m10 = M(1, 0), *m11 = M(1, 1), *m12 = M(1, 2);
+		T *m20 = M(2, 0), *m21 = M(2, 1), *m22 = M(2, 2);
+		detail::forChunks(n, options, [=](std::size_t begin, std::size_t end){
+			detail::forEach(end - begin, [=](std::size_t j){
+				const std::size_t i = begin + j;
+				T w, x, y, z;
+				::detail::uniformQuaternion(seed, first + i, w, x, y, z);
+				m00[i] = T(-1) + 2*x*x + 2*w*w; m01[i] = 2*(x*y - z*w);        m02[i] = 2*(x*z + y*w);
+				m10[i] = 2*(x*y + z*w);        m11[i] = T(-1) + 2*y*y + 2*w*w; m12[i] = 2*(y*z - x*w);
+				m20[i] = 2*(x*z - y*w);        m21[i] = 2*(x*w + y*z);        m22[i] = T(-1) + 2*z*z + 2*w*w;
+			});
+		});
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <array>
+#include <optional>
+#include "matrix.hpp"
+#include "quaternion.hpp"
+
+//Rigid transform (SE(3)): v' = R v + t, a rotation followed by a translation. The rotation is a validated
+//UnitQuaternion, so applying and composing need no checks. Batch application to Points is Points::transform.
+template<typename T>
+class RigidTransform{
+	private:
+	UnitQuaternion<T> r;
+	std::array<T,3> t;
+	public:
+	constexpr RigidTransform(): r{}, t{{0, 0, 0}} {} //identity
+	constexpr RigidTransform(const UnitQuaternion<T> &rotation, const std::array<T,3> &translation = {0, 0, 0}): r{rotation}, t{translation} {}
+	RigidTransform( RigidTransform const& ) = default; //copy const
+	RigidTransform<T>& operator=(RigidTransform const&) = default;
+
+	//Fails if M is not a rotation matrix
+	static std::optional<RigidTransform<T>> fromMatrix(const Matrix3<T> &M, const std::array<T,3> &translation = {0, 0, 0}) {
+		auto checked = RotationMatrix<T>::fromMatrix(M);
+		if(!checked){
+			return std::nullopt;
+		}
+		return RigidTransform<T>(checked.value().convertToQuaternion(), translation);
+	}
+
+	//Rotation about pivot, then translation: v' = R (v - pivot) + pivot + translation
+	static constexpr RigidTransform<T> aboutPivot(const UnitQuaternion<T> &rotation, const std::array<T,3> &pivot,
+	                                              const std::array<T,3> &translation = {0, 0, 0}) {
+		const std::array<T,3> rp = rotation.apply(pivot);
+		return RigidTransform<T>(rotation, {pivot[0] + translation[0] - rp[0], pivot[1] + translation[1] - rp[1], pivot[2] + translation[2] - rp[2]});
+	}
+
+	constexpr const UnitQuaternion<T>& rotation() const {
+		return r;
+	}
+	constexpr const std::array<T,3>& translation() const {
+		return t;
+	}
+	constexpr RotationMatrix<T> matrix() const {
+		return r.convertToMatrix();
+	}
+
+	//v' = R^-1 (v - t)
+	constexpr RigidTransform<T> inv() const {
+		const UnitQuaternion<T> ri = r.inv();
+		const std::array<T,3> rt = ri.apply(t);
+		return RigidTransform<T>(ri, {-rt[0], -rt[1], -rt[2]});
+	}
+
+	constexpr std::array<T,3> apply(const std::array<T,3> &v) const {
+		const std::array<T,3> rv = r.apply(v);
+		return {rv[0] + t[0], rv[1] + t[1], rv[2] + t[2]};
+	}
+
+	//a*b: b first, then a
+	friend constexpr RigidTransform<T> operator*(const RigidTransform<T> &a, const RigidTransform<T> &b) {
+		const std::array<T,3> at = a.r.apply(b.t);
+		return RigidTransform<T>(a.r*b.r, {at[0] + a.t[0], at[1] + a.t[1], at[2] + a.t[2]});
+	}
+};
+
+template<typename T>
+constexpr std::array<T,3> operator*(const RigidTransform<T> &X, const std::array<T,3> &v) {
+	return X.apply(v);
+}
@@ -0,0 +1,196 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "matrix.hpp"
+#include "quaternion.hpp"
+#include "axisAngle.hpp"
+
+//Promise to the compiler that the arrays read and written by a batch loop do not overlap, so the loop vectorizes
+//without run-time alias checks (__restrict on local pointers is ignored by GCC). Put it right before the loop.
+#if defined(__clang__)
+#define ROTATIONS_IVDEP _Pragma("clang loop vectorize(assume_safety)")
+#elif defined(__GNUC__)
+#define ROTATIONS_IVDEP _Pragma("GCC ivdep")
+#elif defined(_MSC_VER)
+#define ROTATIONS_IVDEP __pragma(loop(ivdep))
+#else
+#define ROTATIONS_IVDEP
+#endif
+
+//Inline everything a batch loop calls, which the loop needs to vectorize: in a large translation unit GCC's
+//inliner may otherwise stop short (e.g. of fastmath::sincos). Put it on the function holding the loop.
+#if defined(__GNUC__) || defined(__clang__)
+#define ROTATIONS_FLATTEN __attribute__((flatten))
+#else
+#define ROTATIONS_FLATTEN
+#endif
+
+//Arrays of rotations, stored as structure of arrays: one contiguous array per component
+
+//One entry per element of a batch: 1 if the result is valid, 0 if not (in place of std::optional)
+using ValidityMask = std::vector<std::uint8_t>;
+
+template<typename T>
+class QuaternionArray{
+	private:
+	std::vector<T> ws, xs, ys, zs;
+	public:
+	QuaternionArray() = default;
+	explicit QuaternionArray(std::size_t n): ws(n), xs(n), ys(n), zs(n) {}
+
+	std::size_t size() const {
+		return ws.size();
+	}
+	void resize(std::size_t n) {
+		ws.resize(n);
+		xs.resize(n);
+		ys.resize(n);
+		zs.resize(n);
+	}
+	void push_back(const quaternion<T> &q) {
+		ws.push_back(q.w());
+		xs.push_back(q.x());
+		ys.push_back(q.y());
+		zs.push_back(q.z());
+	}
+	quaternion<T> operator[](std::size_t i) const { //read only
+		return {ws[i], xs[i], ys[i], zs[i]};
+	}
+	void set(std::size_t i, const quaternion<T> &q) {
+		ws[i] = q.w();
+		xs[i] = q.x();
+		ys[i] = q.y();
+		zs[i] = q.z();
+	}
+
+	T* w() {
+		return ws.data();
+	}
+	T* x() {
+		return xs.data();
+	}
+	T* y() {
+		return ys.data();
+	}
+	T* z() {
+		return zs.data();
+	}
+	const T* w() const {
+		return ws.data();
+	}
+	const T* x() const {
+		return xs.data();
+	}
+	const T* y() const {
+		return ys.data();
+	}
+	const T* z() const {
+		return zs.data();
+	}
+};
+
+template<typename T>
+class MatrixArray{
+	private:
+	std::array<std::vector<T>, 9> elements; //row major, like Matrix3
+	public:
+	MatrixArray() = default;
+	explicit MatrixArray(std::size_t n) {
+		resize(n);
+	}
+
+	std::size_t size() const {
+		return elements[0].size();
+	}
+	void resize(std::size_t n) {
+		for(auto &e : elements){
+			e.resize(n);
+		}
+	}
+	void push_back(const Matrix3<T> &M) {
+		for(int k = 0; k < 9; ++k){
+			elements[k].push_back(M[k]);
+		}
+	}
+	Matrix3<T> operator[](std::size_t i) const { //read only
+		Matrix3<T> M;
+		for(int k = 0; k < 9; ++k){
+			M[k] = elements[k][i];
+		}
+		return M;
+	}
+	void set(std::size_t i, const Matrix3<T> &M) {
+		for(int k = 0; k < 9; ++k){
+			elements[k][i] = M[k];
+		}
+	}
+
+	//Array of the (i, j) elements of all matrices
+	T* operator()(int i, int j) {
+		return elements[3*i + j].data();
+	}
+	const T* operator()(int i, int j) const {
+		return elements[3*i + j].data();
+	}
+};
+
+template<typename T>
+class AxisAngleArray{
+	private:
+	std::vector<T> xs, ys, zs, angles;
+	public:
+	AxisAngleArray() = default;
+	explicit AxisAngleArray(std::size_t n): xs(n), ys(n), zs(n), angles(n) {}
+
+	std::size_t size() const {
+		return angles.size();
+	}
+	void resize(std::size_t n) {
+		xs.resize(n);
+		ys.resize(n);
+		zs.resize(n);
+		angles.resize(n);
+	}
+	void push_back(const axisAngle<T> &a) {
+		xs.push_back(a.x());
+		ys.push_back(a.y());
+		zs.push_back(a.z());
+		angles.push_back(a.getAngle());
+	}
+	axisAngle<T> operator[](std::size_t i) const { //read only
+		return {xs[i], ys[i], zs[i], angles[i]};
+	}
+	void set(std::size_t i, const axisAngle<T> &a) {
+		xs[i] = a.x();
+		ys[i] = a.y();
+		zs[i] = a.z();
+		angles[i] = a.getAngle();
+	}
+
+	T* x() {
+		return xs.data();
+	}
+	T* y() {
+		return ys.data();
+	}
+	T* z() {
+		return zs.data();
+	}
+	T* angle() {
+		return angles.data();
+	}
+	const T* x() const {
+		return xs.data();
+	}
+	const T* y() const {
+		return ys.data();
+	}
+	const T* z() const {
+		return zs.data();
+	}
+	const T* angle() const {
+		return angles.data();
+	}
+};
@@ -0,0 +1,160 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <algorithm>
+#include "matrix.hpp"
+#include "quaternion.hpp"
+#include "points.hpp"
+#include "parallel.hpp"
+#include "batchConversion.hpp"
+
+//Table of precomputed rotations, looked up by index: for a small set of discrete rotations applied over and
+//over (the 24 symmetries of the cube, bins of yaw), so that sin and cos are not recomputed at every use.
+//Every entry holds its padded matrix and its unit quaternion, aligned to a cache line (one line per entry in
+//float, two in double). The matrix coefficients are also kept as 9 planes, coefficient k of every entry
+//contiguous, so that applying a different rotation to every point is a gather the compiler vectorizes.
+template<typename T>
+class RotationTable{
+	public:
+	struct alignas(64) Entry{
+		Matrix3x4<T> matrix;
+		UnitQuaternion<T> quaternion;
+	};
+
+	private:
+	std::vector<Entry> entries;
+	std::array<std::vector<T>, 9> planes; //planes[3*i + j][k]: coefficient (i, j) of entry k
+
+	//out[p] = entry index[p] applied to in[p]; indices already checked. out may be in.
+	void gatherApply(const std::uint32_t *index, const T *x, const T *y, const T *z, T *xOut, T *yOut, T *zOut, std::size_t n) const {
+		const T *m00 = planes[0].data(), *m01 = planes[1].data(), *m02 = planes[2].data();
+		const T *m10 = planes[3].data(), *m11 = planes[4].data(), *m12 = planes[5].data();
+		const T *m20 = planes[6].data(), *m21 = planes[7].data(), *m22 = planes[8].data();
+		batch::detail::forEach(n, [=](std::size_t p){
+			const std::uint32_t k = index[p];
+			const T px = x[p], py = y[p], pz = z[p];
+			xOut[p] = m00[k]*px + m01[k]*py + m02[k]*pz;
+			yOut[p] = m10[k]*px + m11[k]*py + m12[k]*pz;
+			zOut[p] = m20[k]*px + m21[k]*py + m22[k]*pz;
+		});
+	}
+
+	public:
+	RotationTable() = default;
+	explicit RotationTable(const std::vector<UnitQuaternion<T>> &rotations) {
+		entries.reserve(rotations.size());
+		for(const auto &q : rotations){
+			add(q);
+		}
+	}
+
+	//Appends a rotation, returns its index
+	std::uint32_t add(const UnitQuaternion<T> &q) {
+		const RotationMatrix<T> M = q.convertToMatrix();
+		entries.push_back({Matrix3x4<T>(M.value()), q});
+		for(int k = 0; k < 9; ++k){
+			planes[k].push_back(M[k]);
+		}
+		return static_cast<std::uint32_t>(entries.size() - 1);
+	}
+
+	std::size_t size() const {
+		return entries.size();
+	}
+	const Entry& operator[](std::size_t i) const { //read only
+		return entries[i];
+	}
+	const Matrix3x4<T>& matrix(std::size_t i) const {
+		return entries[i].matrix;
+	}
+	const UnitQuaternion<T>& quaternion(std::size_t i) const {
+		return entries[i].quaternion;
+	}
+
+	//Rotate a vector by entry i. No checks.
+	std::array<T,3> apply(std::size_t i, const std::array<T,3> &v) const {
+		const Matrix3x4<T> &M = entries[i].matrix;
+		return {M(0, 0)*v[0] + M(0, 1)*v[1] + M(0, 2)*v[2],
+		        M(1, 0)*v[0] + M(1, 1)*v[1] + M(1, 2)*v[2],
+		        M(2, 0)*v[0] + M(2, 1)*v[1] + M(2, 2)*v[2]};
+	}
+
+	//out[p] = entry index[p] applied to in[p]; out is resized, and may be in itself.
+	//Returns false (and leaves out untouched) if the sizes differ or an index is not in the table.
+	bool apply(const Points<T> &in, const std::vector<std::uint32_t> &index, Points<T> &out, const ParallelOptions &options = {}) const {
+		const std::size_t n = in.size();
+		if(index.size() != n){
+			return false;
+		}
+		std::uint32_t largest = 0;
+		for(std::size_t p = 0; p < n; ++p){
+			largest = std::max(largest, index[p]);
+		}
+		if(n > 0 and largest >= size()){
+			return false;
+		}
+		out.resize(n);
+		if(!options.pool){
+			gatherApply(index.data(), in.x(), in.y(), in.z(), out.x(), out.y(), out.z(), n);
+			return true;
+		}
+		options.pool->parallelFor(n, options.chunkSize, [&](std::size_t begin, std::size_t end){
+			gatherApply(index.data() + begin, in.x() + begin, in.y() + begin, in.z() + begin,
+			            out.x() + begin, out.y() + begin, out.z() + begin, end - begin);
+		});
+		return true;
+	}
+
+	//The 24 rotations of the cube onto itself: the signed permutation matrices of determinant 1.
+	//Entry 0 is the identity.
+	static RotationTable cubeSymmetries() {
+		RotationTable table;
+		const std::array<std::array<int, 3>, 6> permutations{{{0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0}}};
+		for(const auto &permutation : permutations){
+			for(int signs = 0; signs < 8; ++signs){
+				Matrix3<T> M;
+				for(int i = 0; i < 3; ++i){
+					M(i, permutation[i]) = (signs >> i) & 1 ? T(-1) : T(1);
+				}
+				if(M.determinant() > 0){
+					table.add(UnitQuaternion<T>::fromQuaternion(M.convertToQuaternion().value()).value());
+				}
+			}
+		}
+		return table;
+	}
+
+	//bins rotations around axis, entry k by the angle 2 pi k / bins (k = bin(angle) finds it).
+	//Fails for a zero axis or no bins.
+	static std::optional<RotationTable> aboutAxis(const std::array<T,3> &axis, std::size_t bins) {
+		const T norm = std::sqrt(axis[0]*axis[0] + axis[1]*axis[1] + axis[2]*axis[2]);
+		if(!(norm > 0) or bins == 0){
+			return std::nullopt;
+		}
+		constexpr T pi = T(3.14159265358979323846);
+		RotationTable table;
+		table.entries.reserve(bins);
+		for(std::size_t k = 0; k < bins; ++k){
+			const T half = pi*static_cast<T>(k)/static_cast<T>(bins);
+			const T s = std::sin(half)/norm;
+			table.add(UnitQuaternion<T>::fromQuaternion({std::cos(half), axis[0]*s, axis[1]*s, axis[2]*s}).value());
+		}
+		return table;
+	}
+
+	//Bin of a table made by aboutAxis(axis, bins) nearest to angle (any angle, wrapped around the circle)
+	static std::uint32_t bin(T angle, std::size_t bins) {
+		constexpr T twoPi = T(6.283185307179586476925);
+		const T turns = angle/twoPi;
+		const T fraction = turns - std::floor(turns); //in [0, 1)
+		const std::size_t k = static_cast<std::size_t>(std::lround(fraction*static_cast<T>(bins)));
+		return static_cast<std::uint32_t>(k == bins ? 0 : k);
+	}
+};
+
+static_assert(sizeof(RotationTable<double>::Entry) == 128 and alignof(RotationTable<double>::Entry) == 64, "RotationTable<double> entries take two cache lines");
+static_assert(sizeof(RotationTable<float>::Entry) == 64, "RotationTable<float> entries take one cache line");
@@ -6,6 +6,12 @@
 #include "matrix.hpp"
 #include "axisAngle.hpp"
 #include <iterator>
+#include <algorithm>
+#include <vector>
+#include <array>
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
 
 template<typename F, typename K>
  bool areEqual(const K &reference, const  F & q, const double precision = 1e-6) {
@@ -13,6 +19,23 @@ template<typename F, typename K>
     return (std::equal (q.cbegin(), q.cend(), reference.cbegin(), [=](const auto x, const auto y){return std::abs(x - y) < precision;})) ;
 }  
 
+//Largest difference between the rotations of two unit quaternions (q and -q are the same rotation)
+template<typename T>
+double quaternionDistance(const UnitQuaternion<T> &a, const UnitQuaternion<T> &b) {
+    const double sign = a.w()*b.w() + a.x()*b.x() + a.y()*b.y() + a.z()*b.z() < 0 ? -1. : 1.;
+    return std::max({std::abs(a.w() - sign*b.w()), std::abs(a.x() - sign*b.x()), std::abs(a.y() - sign*b.y()), std::abs(a.z() - sign*b.z())});
+}
+
+//1001 points on a curve, the input of the batch kernel tests: an odd size, so that no kernel can assume a
+//multiple of the vector width
+inline std::vector<std::array<double,3>> oddSizedCloud() {
+    std::vector<std::array<double,3>> raw;
+    for(int i = 0; i < 1001; ++i){
+        raw.push_back({std::cos(0.1*i), std::sin(0.3*i), 0.005*i - 1.});
+    }
+    return raw;
+}
+
 
 
 void TestAxisAngle(){
@@ -114,12 +137,16 @@ void TestMatrix(){
     0.0000000,  0.1542515,  0.9880316;
     0.0000000, -0.9880316,  0.1542515 */
 
-    // quaternion: [ x = 0.6502878, y = 0,  z = 0, w = -0.7596879 ]
+    // quaternion: [ x = 0.6502878, y = 0,  z = 0, w = -0.7596879 ], returned as its opposite (w >= 0)
         Matrix3<double> m({1., 0., 0., 0. , 0.1542515 , 0.9880316, 0., -0.9880316, 0.1542515});
         auto q = m.convertToQuaternion();
-        if(q){
+        if(!q){
+            numErrors++;
+            std::cout << "matrix -> quaternion conversion rejected a rotation \n";
+        }
+        else{
             auto val = q.value();
-            if(!areEqual(std::array<double, 4>{-0.7596879, 0.6502878, 0., 0.}, val )){
+            if(!areEqual(std::array<double, 4>{0.7596879, -0.6502878, 0., 0.}, val )){
                 numErrors++;
                 std::cout << "matrix -> quaternion conversion failed \n";
                 std::cout << "x: " << val.x() << " y: " << val.y() << " z: " << val.z() << " w: " << val.w() << " \n";
@@ -128,6 +155,43 @@ void TestMatrix(){
             }
         }
     }
+    //Matrix -> quaternion where dividing by x fails: the identity, rotations by pi, and a sweep of axes and angles
+    {
+        std::vector<std::pair<Matrix3<double>, std::array<double, 4>>> cases{
+            {Matrix3<double>({1., 0., 0., 0., 1., 0., 0., 0., 1.}), {1., 0., 0., 0.}},
+            {Matrix3<double>({1., 0., 0., 0., -1., 0., 0., 0., -1.}), {0., 1., 0., 0.}},
+            {Matrix3<double>({-1., 0., 0., 0., 1., 0., 0., 0., -1.}), {0., 0., 1., 0.}},
+            {Matrix3<double>({-1., 0., 0., 0., -1., 0., 0., 0., 1.}), {0., 0., 0., 1.}}};
+        bool failed = false;
+        for(const auto &[matrix, expected] : cases){
+            auto q = matrix.convertToQuaternion();
+            failed = failed or !q or !areEqual(expected, *q, 1e-15);
+        }
+        double maxError = 0.;
+        constexpr double pi = 3.14159265358979323846;
+        for(int i = 0; i < 1000; ++i){
+            const double t = 0.37*i;
+            axisAngle<double> a({std::sin(t)*std::cos(3*t), std::sin(t)*std::sin(3*t), std::cos(t)}, -pi + 2*pi*i/999);
+            Matrix3<double> matrix = *a.convertToMatrix();
+            auto q = matrix.convertToQuaternion();
+            if(!q){
+                failed = true;
+                continue;
+            }
+            maxError = std::max(maxError, std::abs(q->norm() - 1.));
+            Matrix3<double> back = q->convertToMatrix();
+            for(int k = 0; k < 9; ++k){
+                maxError = std::max(maxError, std::abs(back[k] - matrix[k]));
+            }
+            failed = failed or q->w() < 0.;
+        }
+        RotationMatrix<double> rotation = RotationMatrix<double>::fromMatrix(cases[1].first).value();
+        if(failed or maxError > 1e-14 or !areEqual(cases[1].second, rotation.convertToQuaternion().value(), 1e-15)
+           or Matrix3<double>({1., 2., 3., 4., 5., 6., 7., 8., 9.}).convertToQuaternion()){
+            numErrors++;
+            std::cout << "matrix -> quaternion conversion is not robust: " << maxError << " \n";
+        }
+    }
     //Test the rotation operator: M*v. Same matrix as above
     {
         Matrix3<double> m({1., 0., 0., 0. , 0.1542515 , 0.9880316, 0., -0.9880316, 0.1542515});
@@ -153,6 +217,77 @@ void TestMatrix(){
             std::cout << "Matrix multiplication  operator failed \n";   
         }
     }
+    //Chained products are lazy: applied to a vector right to left, evaluated when assigned to a Matrix3
+    {
+        Matrix3<double> a = *axisAngle<double>({0., 0., 1.}, 0.3).convertToMatrix();
+        Matrix3<double> b = *axisAngle<double>({0., 0.6, 0.8}, -1.1).convertToMatrix();
+        Matrix3<double> c = *axisAngle<double>({1., 0., 0.}, 2.7).convertToMatrix();
+        std::array<double,3> v{0.3, -1., 2.};
+        static_assert(!std::is_same_v<decltype(a*b*c), Matrix3<double>>, "matrix products should be lazy");
+        Matrix3<double> ab = a*b;
+        Matrix3<double> abc = ab*c;
+        auto lazy = a*b*c*v, grouped = a*(b*c)*v, pairs = (a*b)*(c*a)*v;
+        if(!lazy or !grouped or !pairs or !areEqual(*(abc*v), *lazy, 1e-14) or !areEqual(*(abc*v), *grouped, 1e-14)
+           or !areEqual(*(ab*(c*a).evaluate()*v), *pairs, 1e-14) or !areEqual(abc, Matrix3<double>(a*b*c), 1e-15)){
+            numErrors++;
+            std::cout << "lazy matrix product failed \n";
+        }
+        Matrix3<double> stretched({2., 0., 0., 0., 1., 0., 0., 0., 1.});
+        if(a*stretched*b*v or !(a*b).isRotation()){
+            numErrors++;
+            std::cout << "lazy matrix product accepted a product that is not a rotation \n";
+        }
+        //factors that are not rotations but multiply to one: multiplied out once, checked and applied
+        Matrix3<double> shear({1., 0.5, 0., 0., 1., 0., 0., 0., 1.}), unshear({1., -0.5, 0., 0., 1., 0., 0., 0., 1.});
+        auto undone = a*shear*unshear*v;
+        if(!undone or !areEqual(*(a*v), *undone, 1e-14) or !(shear*unshear).isRotation() or a*shear*b*v){
+            numErrors++;
+            std::cout << "lazy matrix product with non-rotation factors failed \n";
+        }
+    }
+    //Validated rotation matrix: checked once, applied without checks
+    {
+        Matrix3<double> m({1., 0., 0., 0. , 0.1542515 , 0.9880316, 0., -0.9880316, 0.1542515});
+        std::array<double,3> vec{0.3, 1., -2.};
+        auto r = RotationMatrix<double>::fromMatrix(m);
+        if(!r or !areEqual((m*vec).value(), r.value()*vec)){
+            numErrors++;
+            std::cout << "RotationMatrix::apply failed \n";
+        }
+        if(r and !areEqual(vec, r.value().inv()*(r.value()*vec))){
+            numErrors++;
+            std::cout << "RotationMatrix::inv failed \n";
+        }
+        if(RotationMatrix<double>::fromMatrix(Matrix3<double>({1., 2., 3., 4., 5., 6., 7., 8., 9.}))){
+            numErrors++;
+            std::cout << "RotationMatrix accepted a non-rotation \n";
+        }
+        const Matrix3<double> shear({1., 0.5, 0., 0., 1., 0., 0., 0., 1.}); //det 1, but not orthogonal
+        if(shear.isRotation() or RotationMatrix<double>::fromMatrix(shear) or shear.convertToQuaternion()){
+            numErrors++;
+            std::cout << "RotationMatrix accepted a shear \n";
+        }
+    }
+    //Arrays of matrices are plain arrays of 9 elements
+    {
+        std::vector<Matrix3<double>> matrices{Matrix3<double>({1., 2., 3., 4., 5., 6., 7., 8., 9.}), Matrix3<double>({0., -1., 0., 1., 0., 0., 0., 0., 1.})};
+        std::vector<double> raw(9*matrices.size());
+        std::memcpy(raw.data(), matrices.data(), raw.size()*sizeof(double));
+        std::vector<Matrix3<double>> copies(matrices.size());
+        std::memcpy(static_cast<void*>(copies.data()), raw.data(), raw.size()*sizeof(double)); //trivially copyable, not trivial (zeroed by default)
+        //copies of the bits, so compared exactly
+        auto same = [](const Matrix3<double> &a, const Matrix3<double> &b){ return std::equal(a.cbegin(), a.cend(), b.cbegin()); };
+        if(raw[9 + 1] != -1. or !same(matrices[0], copies[0]) or !same(matrices[1], copies[1])){
+            numErrors++;
+            std::cout << "Matrix3 memcpy failed \n";
+        }
+        Matrix3x4<double> padded(matrices[0]);
+        if(padded(1, 2) != 6. or padded.row(2)[3] != 0. or !same(matrices[0], padded.matrix())
+           or reinterpret_cast<std::uintptr_t>(padded.row(1)) % 32 != 0){
+            numErrors++;
+            std::cout << "Matrix3x4 failed \n";
+        }
+    }
     //Test matrix -> axis-angle conversion:
     {
         Matrix3<double> m({1., 0., 0., 0. , 0.1542515 , 0.9880316, 0., -0.9880316, 0.1542515});
@@ -247,6 +382,35 @@ void TestQuaternion() {
             std::cout << "std::optional error \n";
         }
     }   
+    //Unit quaternion: normalized once, applied without checks
+    {
+        quaternion<double> q{-0.7596879, 0.6502878, 0., 0.};
+        quaternion<double> scaled{2*q.w(), 2*q.x(), 2*q.y(), 2*q.z()};
+        std::array<double,3> r {0.3, 1., -2.};
+        auto u = UnitQuaternion<double>::fromQuaternion(scaled);
+        if(!u or !areEqual(*rotateByQuaternion(q, r), u.value()*r)){
+            numErrors++;
+            std::cout << "UnitQuaternion::apply failed \n";
+        }
+        if(u and !areEqual(u.value().convertToMatrix().apply(r), u.value().apply(r))){
+            numErrors++;
+            std::cout << "UnitQuaternion -> RotationMatrix conversion failed \n";
+        }
+        if(UnitQuaternion<double>::fromQuaternion(quaternion<double>{})){
+            numErrors++;
+            std::cout << "UnitQuaternion accepted the zero quaternion \n";
+        }
+    }
+    //rotateByQuaternion's cross product form against the product q r q^-1
+    {
+        quaternion<double> q = *axisAngle<double>({0.48, 0.6, 0.64}, 2.3).convertToQuaternion();
+        std::array<double,3> r {0.3, 1., -2.};
+        quaternion<double> sandwich = q*quaternion<double>(0., r)*q.inv();
+        if(!areEqual(sandwich.vectorPart(), *rotateByQuaternion(q, r), 1e-15)){
+            numErrors++;
+            std::cout << "rotateByQuaternion differs from q r q^-1 \n";
+        }
+    }
     //Testing optional 
     {
     // quaternion: [ x = 99, y = 123,  z =110, w = -0.7596879 ]
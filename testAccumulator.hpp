@@ -0,0 +1,78 @@
+#pragma once
+#include <iostream>
+#include <cmath>
+#include <vector>
+#include "quaternion.hpp"
+#include "matrix.hpp"
+#include "accumulator.hpp"
+#include "test.hpp"
+
+void TestAccumulator(){
+    int numErrors = 0;
+    // 100000 small rotations around z add up to one rotation by the total angle
+    const int steps = 100000;
+    const double step = 1e-4;
+    std::vector<quaternion<double>> increments(steps, quaternion<double>{std::cos(step/2), 0., 0., std::sin(step/2)});
+    const double total = steps*step;
+    const std::array<double, 4> expected{std::cos(total/2), 0., 0., std::sin(total/2)};
+    {
+        RotationAccumulator<double> one;
+        for(const auto &q : increments){
+            one.compose(q);
+        }
+        RotationAccumulator<double> all;
+        all.composeAll(increments.data(), increments.size());
+        if(!areEqual(expected, one.value(), 1e-9) or !areEqual(expected, all.value(), 1e-9)){
+            numErrors++;
+            std::cout << "RotationAccumulator composition failed \n";
+        }
+        if(!all.value().isRotation()){
+            numErrors++;
+            std::cout << "RotationAccumulator result is not a rotation \n";
+        }
+    }
+    // Increments with a norm error: the plain product drifts out of isRotation(), the accumulator does not
+    {
+        quaternion<double> sloppy{1.000001*std::cos(step/2), 0., 0., 1.000001*std::sin(step/2)};
+        quaternion<double> plain{1., 0., 0., 0.};
+        RotationAccumulator<double> accumulator;
+        for(int i = 0; i < 1000; ++i){
+            plain = plain*sloppy;
+            accumulator.compose(sloppy);
+        }
+        if(plain.isRotation() or !accumulator.value().isRotation() or accumulator.renormalizationCount() == 0){
+            numErrors++;
+            std::cout << "RotationAccumulator renormalization failed \n";
+        }
+        if(!areEqual(std::array<double, 4>{std::cos(0.05), 0., 0., std::sin(0.05)}, accumulator.value(), 1e-9)){
+            numErrors++;
+            std::cout << "RotationAccumulator renormalization changed the rotation \n";
+        }
+    }
+    // Larger norm errors (1e-3, 0.05) are pulled back within the tolerance in one step
+    {
+        for(double error : {1e-3, 0.05}){
+            RotationAccumulator<double> accumulator;
+            accumulator.compose(quaternion<double>{(1. + error)*std::cos(0.1), (1. + error)*std::sin(0.1), 0., 0.});
+            const quaternion<double> q = accumulator.value();
+            if(std::abs(q.w()*q.w() + q.x()*q.x() + q.y()*q.y() + q.z()*q.z() - 1.) > detail::rotationTolerance<double>/10){
+                numErrors++;
+                std::cout << "RotationAccumulator left a norm error of " << error << " outside the tolerance \n";
+            }
+        }
+    }
+    // Matrices compose like their quaternions; matrices that are not rotations are rejected
+    {
+        const UnitQuaternion<double> a = UnitQuaternion<double>::fromQuaternion({0.3, -0.5, 0.7, 0.2}).value();
+        const UnitQuaternion<double> b = UnitQuaternion<double>::fromQuaternion({std::cos(0.4), 0., std::sin(0.4), 0.}).value();
+        RotationAccumulator<double> quaternions, matrices;
+        quaternions.compose(a).compose(b);
+        matrices.compose(a.convertToMatrix());
+        const bool composed = matrices.compose(b.convertToMatrix().value());
+        const bool rejected = !matrices.compose(Matrix3<double>({1., 0.5, 0., 0., 1., 0., 0., 0., 1.}));
+        if(!composed or !rejected or !areEqual(quaternions.unitValue().convertToMatrix().value(), matrices.matrix().value(), 1e-14)){
+            numErrors++;
+            std::cout << "RotationAccumulator composition of matrices failed \n";
+        }
+    }
+}
@@ -0,0 +1,117 @@
+// Global operator new and delete of the test program, counting the allocations for TestAllocation.
+// A replacement must be defined once in the whole program, so it lives in this translation unit and not in
+// testAllocation.hpp. Every form is replaced: plain, array, aligned (align_val_t, used by over-aligned types
+// such as RotationTable::Entry) and nothrow, and the deletes match the allocation of each.
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+std::atomic<std::size_t> heapAllocations{0};
+
+namespace
+{
+    void* allocate(std::size_t size) noexcept {
+        heapAllocations++;
+        return std::malloc(size == 0 ? 1 : size);
+    }
+
+    void* allocate(std::size_t size, std::align_val_t alignment) noexcept {
+        heapAllocations++;
+        const std::size_t align = static_cast<std::size_t>(alignment);
+        const std::size_t rounded = size == 0 ? align : (size + align - 1)/align*align; // aligned_alloc wants a multiple
+#ifdef _MSC_VER
+        return _aligned_malloc(rounded, align);
+#else
+        return std::aligned_alloc(align, rounded);
+#endif
+    }
+
+    void* orThrow(void *p) {
+        if(!p){
+            throw std::bad_alloc();
+        }
+        return p;
+    }
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete" // free is the match of the malloc above
+#endif
+    void deallocate(void *p) noexcept {
+        std::free(p);
+    }
+
+    void deallocateAligned(void *p) noexcept {
+#ifdef _MSC_VER
+        _aligned_free(p);
+#else
+        std::free(p);
+#endif
+    }
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+}
+
+void* operator new(std::size_t size) {
+    return orThrow(allocate(size));
+}
+void* operator new[](std::size_t size) {
+    return orThrow(allocate(size));
+}
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    return orThrow(allocate(size, alignment));
+}
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    return orThrow(allocate(size, alignment));
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return allocate(size, alignment);
+}
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return allocate(size, alignment);
+}
+
+void operator delete(void *p) noexcept {
+    deallocate(p);
+}
+void operator delete[](void *p) noexcept {
+    deallocate(p);
+}
+void operator delete(void *p, std::size_t) noexcept {
+    deallocate(p);
+}
+void operator delete[](void *p, std::size_t) noexcept {
+    deallocate(p);
+}
+void operator delete(void *p, const std::nothrow_t&) noexcept {
+    deallocate(p);
+}
+void operator delete[](void *p, const std::nothrow_t&) noexcept {
+    deallocate(p);
+}
+void operator delete(void *p, std::align_val_t) noexcept {
+    deallocateAligned(p);
+}
+void operator delete[](void *p, std::align_val_t) noexcept {
+    deallocateAligned(p);
+}
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept {
+    deallocateAligned(p);
+}
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept {
+    deallocateAligned(p);
+}
+void operator delete(void *p, std::align_val_t, const std::nothrow_t&) noexcept {
+    deallocateAligned(p);
+}
+void operator delete[](void *p, std::align_val_t, const std::nothrow_t&) noexcept {
+    deallocateAligned(p);
+}
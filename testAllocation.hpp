@@ -0,0 +1,98 @@
+#pragma once
+#include <iostream>
+#include <cmath>
+#include <cstddef>
+#include <atomic>
+#include <vector>
+#include <memory_resource>
+#include "quaternion.hpp"
+#include "matrix.hpp"
+#include "points.hpp"
+#include "parallel.hpp"
+#include "batchRotation.hpp"
+#include "rotationTable.hpp"
+#include "test.hpp"
+
+// Calls to the global operator new of the whole test program, in any of its forms (counted in testAllocation.cpp)
+extern std::atomic<std::size_t> heapAllocations;
+
+void TestAllocation(){
+    int numErrors = 0;
+    const std::size_t n = 10007;
+    Points<double> cloud;
+    for(std::size_t i = 0; i < n; ++i){
+        cloud.push_back({std::cos(0.1*i), std::sin(0.3*i), 0.001*i});
+    }
+    const quaternion<double> q{-0.7596879, 0.6502878, 0., 0.};
+    const UnitQuaternion<double> unit = UnitQuaternion<double>::fromQuaternion(q).value();
+    const RotationMatrix<double> M = unit.convertToMatrix();
+    // Steady state: rotating into preallocated points, in place, on a pool, per point and through a table allocates nothing
+    {
+        ThreadPool pool(4);
+        Points<double> out, pooled, perPoint;
+        out.reserve(n);
+        pooled.reserve(n);
+        perPoint.reserve(n);
+        QuaternionArray<double> rotations(n);
+        ValidityMask valid(n);
+        const RotationTable<double> cube = RotationTable<double>::cubeSymmetries();
+        const std::vector<std::uint32_t> index(n, 5);
+        const std::size_t before = heapAllocations;
+        bool ok = true;
+        for(int frame = 0; frame < 10; ++frame){
+            cloud.rotate(M, out);
+            cloud.rotate(unit, out);
+            ok = ok and cloud.rotate(q, out) and cloud.rotate(q.convertToMatrix(), out);
+            cloud.rotate(M, pooled, {&pool, 1000});
+            out.rotateInPlace(M);
+            cloud.transform(RigidTransform<double>(unit, {1., 2., 3.}), out, {&pool, 1000});
+            cloud.rotateAbout(M, {1., 2., 3.}, {0., 0., 1.}, out);
+            out.rotateInPlace(unit, {&pool, 1000});
+            ok = ok and batch::rotate(rotations, cloud, perPoint, valid) and cube.apply(cloud, index, perPoint, {&pool, 1000});
+        }
+        const std::size_t allocations = heapAllocations - before;
+        if(!ok or allocations != 0 or out.size() != n or !areEqual(M*cloud[n - 1], pooled[n - 1], 1e-14)){
+            numErrors++;
+            std::cout << "steady state rotation allocated " << allocations << " times \n";
+        }
+    }
+    // The aligned operator new is counted too: the entries of a table are over-aligned
+    {
+        const std::size_t before = heapAllocations;
+        const RotationTable<double> cube = RotationTable<double>::cubeSymmetries();
+        if(heapAllocations == before or cube.size() != 24){
+            numErrors++;
+            std::cout << "aligned allocations were not counted \n";
+        }
+    }
+    // Points on an arena: no heap allocation at all, even for rotate by value
+    {
+        std::vector<std::byte> buffer(std::size_t(1) << 20);
+        std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size(), std::pmr::null_memory_resource()); //throws if exhausted
+        const std::size_t before = heapAllocations;
+        Points<double> frame(&arena);
+        frame.resize(n);
+        for(std::size_t i = 0; i < n; ++i){
+            frame.x()[i] = cloud.x()[i];
+            frame.y()[i] = cloud.y()[i];
+            frame.z()[i] = cloud.z()[i];
+        }
+        Points<double> rotated = frame.rotate(M);
+        const std::size_t allocations = heapAllocations - before;
+        if(allocations != 0 or rotated.resource() != &arena or !areEqual(cloud.rotate(M)[17], rotated[17], 1e-15)){
+            numErrors++;
+            std::cout << "Points on an arena allocated " << allocations << " times on the heap \n";
+        }
+    }
+    // A copy goes to the default heap, so it can outlive the arena
+    {
+        std::pmr::monotonic_buffer_resource arena;
+        Points<double> frame(&arena);
+        frame.push_back({1., 2., 3.});
+        const Points<double> copy = frame;
+        if(copy.resource() != std::pmr::get_default_resource() or !areEqual(copy[0], frame[0], 1e-15)){
+            numErrors++;
+            std::cout << "copy of arena Points failed \n";
+        }
+    }
+}
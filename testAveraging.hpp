@@ -0,0 +1,144 @@
+#pragma once
+#include <iostream>
+#include <cmath>
+#include <vector>
+#include <limits>
+#include "quaternion.hpp"
+#include "rotationArrays.hpp"
+#include "parallel.hpp"
+#include "averaging.hpp"
+#include "test.hpp"
+
+void TestAveraging(){
+    int numErrors = 0;
+    constexpr double pi = 3.14159265358979323846;
+    auto aboutAxis = [](double x, double y, double z, double angle){
+        const double s = std::sin(angle/2)/std::sqrt(x*x + y*y + z*z);
+        return UnitQuaternion<double>::fromQuaternion({std::cos(angle/2), s*x, s*y, s*z}).value();
+    };
+    // Two rotations about one axis: both means are the rotation by the mean angle
+    {
+        RotationAverage<double> average;
+        average.add(aboutAxis(1., 2., 3., 0.2));
+        average.add(aboutAxis(1., 2., 3., 0.8));
+        const auto mean = average.mean(), chordal = average.chordalMean();
+        if(!mean or !chordal or quaternionDistance(*mean, aboutAxis(1., 2., 3., 0.5)) > 1e-15
+           or quaternionDistance(*chordal, aboutAxis(1., 2., 3., 0.5)) > 1e-15 or average.size() != 2 or average.weight() != 2.){
+            numErrors++;
+            std::cout << "RotationAverage of two rotations failed \n";
+        }
+    }
+    // A cluster symmetric about r, with the signs of half the quaternions flipped: the mean is r, and the same
+    // from single samples, from an array, and from an array on pools of any size
+    const UnitQuaternion<double> r = UnitQuaternion<double>::fromQuaternion({0.3, -0.5, 0.7, 0.2}).value();
+    QuaternionArray<double> cluster;
+    for(int i = 0; i < 1000; ++i){
+        const UnitQuaternion<double> d = aboutAxis(std::cos(0.37*i), std::sin(0.37*i), std::cos(1.1*i), 0.3);
+        const quaternion<double> q = (r*d).value(), p = (r*d.inv()).value();
+        cluster.push_back(i % 2 ? q : quaternion<double>(-q.w(), -q.x(), -q.y(), -q.z()));
+        cluster.push_back(i % 3 ? p : quaternion<double>(-p.w(), -p.x(), -p.y(), -p.z()));
+    }
+    {
+        RotationAverage<double> single, serial, parallel4, parallel2;
+        for(std::size_t i = 0; i < cluster.size(); ++i){
+            single.add(UnitQuaternion<double>::fromQuaternion(cluster[i]).value());
+        }
+        ThreadPool pool4(4), pool2(2);
+        serial.add(cluster);
+        parallel4.add(cluster, {&pool4, 100});
+        parallel2.add(cluster, {&pool2, 100});
+        const auto mean = single.mean(), chordal = single.chordalMean(), serialMean = serial.mean();
+        const auto mean4 = parallel4.mean(), mean2 = parallel2.mean(), chordal4 = parallel4.chordalMean(), chordal2 = parallel2.chordalMean();
+        if(!mean or !chordal or !serialMean or !mean4 or !mean2 or !chordal4 or !chordal2
+           or quaternionDistance(*mean, r) > 1e-14 or quaternionDistance(*chordal, r) > 1e-14 or quaternionDistance(*serialMean, r) > 1e-14
+           or quaternionDistance(*mean4, r) > 1e-14 or quaternionDistance(*chordal4, r) > 1e-14
+           or mean4->w() != mean2->w() or mean4->x() != mean2->x() or chordal4->w() != chordal2->w() or chordal4->z() != chordal2->z()
+           or serial.size() != cluster.size() or parallel4.size() != cluster.size()){
+            numErrors++;
+            std::cout << "RotationAverage of a cluster failed \n";
+        }
+    }
+    // Weights count as repeated samples, in float too; quaternions that are not unit are skipped
+    {
+        RotationAverage<double> weighted, repeated;
+        const UnitQuaternion<double> a = aboutAxis(0., 0., 1., 0.4), b = aboutAxis(1., 0., 0., -0.6);
+        weighted.add(a, 3.);
+        weighted.add(b);
+        for(int k = 0; k < 3; ++k){
+            repeated.add(a);
+        }
+        repeated.add(b);
+        QuaternionArray<float> q;
+        q.push_back({float(a.w()), float(a.x()), float(a.y()), float(a.z())});
+        q.push_back({2.f, 0.f, 0.f, 0.f});
+        q.push_back({float(b.w()), float(b.x()), float(b.y()), float(b.z())});
+        q.push_back({0.f, 0.f, 0.f, 0.f});
+        RotationAverage<float> arrayFloat;
+        const bool added = arrayFloat.add(q, std::vector<float>{3.f, 5.f, 1.f, 7.f});
+        const auto meanFloat = arrayFloat.mean();
+        const auto expected = UnitQuaternion<float>::fromQuaternion({float(repeated.mean()->w()), float(repeated.mean()->x()),
+                                                                     float(repeated.mean()->y()), float(repeated.mean()->z())}).value();
+        if(!weighted.mean() or !repeated.mean() or quaternionDistance(*weighted.mean(), *repeated.mean()) > 1e-15
+           or quaternionDistance(*weighted.chordalMean(), *repeated.chordalMean()) > 1e-15
+           or !added or !meanFloat or quaternionDistance(*meanFloat, expected) > 1e-6 or arrayFloat.size() != 2 or arrayFloat.weight() != 4.
+           or arrayFloat.add(q, std::vector<float>{1.f}) or arrayFloat.size() != 2){
+            numErrors++;
+            std::cout << "RotationAverage weights failed \n";
+        }
+    }
+    // NaN and infinite quaternions are skipped like the other invalid ones, without poisoning the sums
+    {
+        const double nan = std::numeric_limits<double>::quiet_NaN(), inf = std::numeric_limits<double>::infinity();
+        QuaternionArray<double> part, spoiled;
+        for(std::size_t i = 0; i < 100; ++i){
+            part.push_back(cluster[i]);
+            spoiled.push_back(cluster[i]);
+            if(i % 10 == 3){
+                spoiled.push_back({nan, 0., 0., 0.});
+                spoiled.push_back({inf, inf, 0., 0.});
+            }
+        }
+        RotationAverage<double> clean, dirty;
+        clean.add(part);
+        dirty.add(spoiled);
+        if(!dirty.mean() or !dirty.chordalMean() or dirty.size() != part.size() or quaternionDistance(*dirty.mean(), *clean.mean()) > 1e-15
+           or quaternionDistance(*dirty.chordalMean(), *clean.chordalMean()) > 1e-15){
+            numErrors++;
+            std::cout << "RotationAverage did not skip NaN or infinite quaternions \n";
+        }
+    }
+    // Sliding window: after removing the oldest samples, the mean is that of the others; empty again at the end
+    {
+        RotationAverage<double> window, last;
+        for(std::size_t i = 0; i < 200; ++i){
+            window.add(UnitQuaternion<double>::fromQuaternion(cluster[i]).value());
+        }
+        for(std::size_t i = 0; i < 120; ++i){
+            window.remove(UnitQuaternion<double>::fromQuaternion(cluster[i]).value());
+        }
+        for(std::size_t i = 120; i < 200; ++i){
+            last.add(UnitQuaternion<double>::fromQuaternion(cluster[i]).value());
+        }
+        const auto mean = window.mean(), lastMean = last.mean();
+        bool failed = !mean or !lastMean or quaternionDistance(*mean, *lastMean) > 1e-13 or window.size() != 80
+                      or quaternionDistance(*window.chordalMean(), *last.chordalMean()) > 1e-13;
+        for(std::size_t i = 120; i < 200; ++i){
+            window.remove(UnitQuaternion<double>::fromQuaternion(cluster[i]).value());
+        }
+        failed = failed or window.size() != 0 or window.weight() != 0. or window.mean() or window.chordalMean();
+        if(failed){
+            numErrors++;
+            std::cout << "RotationAverage sliding window failed \n";
+        }
+    }
+    // No samples, or no unique mean (the identity and a rotation by pi, equally weighted)
+    {
+        RotationAverage<double> empty, ambiguous;
+        ambiguous.add(UnitQuaternion<double>());
+        ambiguous.add(aboutAxis(1., 0., 0., pi));
+        if(empty.mean() or empty.chordalMean() or ambiguous.mean()){
+            numErrors++;
+            std::cout << "RotationAverage accepted an undefined mean \n";
+        }
+    }
+}
@@ -0,0 +1,195 @@
+#pragma once
+#include <iostream>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include "quaternion.hpp"
+#include "matrix.hpp"
+#include "axisAngle.hpp"
+#include "fastMath.hpp"
+#include "rotationArrays.hpp"
+#include "batchConversion.hpp"
+#include "test.hpp"
+
+// Largest |fastmath - std| over evenly spaced arguments in [-range, range]
+template<typename T>
+double sincosError(T range, int samples) {
+    double error = 0;
+    for(int i = 0; i <= samples; ++i){
+        T x = static_cast<T>(-range + 2*range*static_cast<T>(i)/static_cast<T>(samples));
+        T s, c;
+        fastmath::sincos(x, s, c);
+        error = std::max({error, std::abs(static_cast<double>(s) - std::sin(static_cast<double>(x))),
+                                 std::abs(static_cast<double>(c) - std::cos(static_cast<double>(x)))});
+    }
+    return error;
+}
+
+template<typename T>
+double atan2Error(int samples) {
+    double error = 0;
+    constexpr double pi = 3.14159265358979323846;
+    for(int i = 0; i < samples; ++i){
+        double angle = 2*pi*i/samples;
+        for(double radius : {1e-3, 1., 1e3}){
+            T y = static_cast<T>(radius*std::sin(angle)), x = static_cast<T>(radius*std::cos(angle));
+            error = std::max(error, std::abs(static_cast<double>(fastmath::atan2(y, x)) - std::atan2(static_cast<double>(y), static_cast<double>(x))));
+        }
+    }
+    return error;
+}
+
+void TestBatchConversion(){
+    int numErrors = 0;
+    constexpr double pi = 3.14159265358979323846;
+    // fastmath against the std:: functions, at the bounds documented in fastMath.hpp
+    {
+        if(sincosError(1e7, 200001) > 5e-16 or sincosError(8192.f, 200001) > 2e-7 or sincosError(0.5, 1001) > 5e-16){
+            numErrors++;
+            std::cout << "fastmath::sincos is not accurate enough \n";
+        }
+        if(atan2Error<double>(10000) > 1e-15 or atan2Error<float>(10000) > 5e-7){
+            numErrors++;
+            std::cout << "fastmath::atan2 is not accurate enough \n";
+        }
+        if(fastmath::atan2(0., 0.) != 0. or fastmath::atan2(0., -1.) != std::atan2(0., -1.) or fastmath::atan2(-0., -1.) != std::atan2(-0., -1.)){
+            numErrors++;
+            std::cout << "fastmath::atan2 special cases failed \n";
+        }
+    }
+    // Axis-angles covering all quadrants, with rotations by pi (the hard case of Shepperd's method)
+    AxisAngleArray<double> axisAngles;
+    for(int i = 0; i < 500; ++i){
+        double theta = 0.37*i, phi = 0.11*i;
+        std::array<double, 3> axis{std::sin(phi)*std::cos(theta), std::sin(phi)*std::sin(theta), std::cos(phi)};
+        double angle = i % 50 == 0 ? pi : -7. + 0.029*i;
+        axisAngles.push_back(axisAngle<double>(axis, angle));
+    }
+    ValidityMask valid;
+    // axis-angle -> quaternion and axis-angle -> matrix against the scalar conversions
+    QuaternionArray<double> quaternions;
+    MatrixArray<double> matrices;
+    {
+        batch::convertToQuaternion(axisAngles, quaternions, valid);
+        bool failed = std::count(valid.begin(), valid.end(), 1) != static_cast<long>(axisAngles.size());
+        for(std::size_t i = 0; i < axisAngles.size(); ++i){
+            failed = failed or !areEqual(*axisAngles[i].convertToQuaternion(), quaternions[i], 1e-14);
+        }
+        batch::convertToMatrix(axisAngles, matrices, valid);
+        failed = failed or std::count(valid.begin(), valid.end(), 1) != static_cast<long>(axisAngles.size());
+        for(std::size_t i = 0; i < axisAngles.size(); ++i){
+            failed = failed or !areEqual(*axisAngles[i].convertToMatrix(), matrices[i], 1e-14);
+        }
+        if(failed){
+            numErrors++;
+            std::cout << "batch axis-angle conversions failed \n";
+        }
+    }
+    // quaternion -> matrix against the scalar conversion
+    {
+        MatrixArray<double> fromQuaternions;
+        batch::convertToMatrix(quaternions, fromQuaternions);
+        bool failed = false;
+        for(std::size_t i = 0; i < quaternions.size(); ++i){
+            failed = failed or !areEqual(quaternions[i].convertToMatrix(), fromQuaternions[i], 1e-14);
+        }
+        if(failed){
+            numErrors++;
+            std::cout << "batch quaternion -> matrix conversion failed \n";
+        }
+    }
+    // matrix -> quaternion gives back the quaternion up to its sign, with w >= 0
+    {
+        QuaternionArray<double> fromMatrices;
+        batch::convertToQuaternion(matrices, fromMatrices, valid);
+        bool failed = std::count(valid.begin(), valid.end(), 1) != static_cast<long>(matrices.size());
+        for(std::size_t i = 0; i < matrices.size(); ++i){
+            quaternion<double> q = quaternions[i], back = fromMatrices[i];
+            double sign = q.w() < 0 ? -1. : 1.;
+            failed = failed or back.w() < 0 or !areEqual(std::array<double, 4>{sign*q.w(), sign*q.x(), sign*q.y(), sign*q.z()}, back, 1e-12);
+        }
+        if(failed){
+            numErrors++;
+            std::cout << "batch matrix -> quaternion conversion failed \n";
+        }
+    }
+    // quaternion -> axis-angle and matrix -> axis-angle, checked by converting back
+    {
+        AxisAngleArray<double> fromQuaternions, fromMatrices;
+        QuaternionArray<double> back;
+        ValidityMask backValid;
+        batch::convertToAxisAngle(quaternions, fromQuaternions, valid);
+        batch::convertToQuaternion(fromQuaternions, back, backValid);
+        bool failed = std::count(valid.begin(), valid.end(), 1) != static_cast<long>(quaternions.size());
+        for(std::size_t i = 0; i < quaternions.size(); ++i){
+            failed = failed or !areEqual(quaternions[i], back[i], 1e-12);
+        }
+        MatrixArray<double> backMatrices;
+        batch::convertToAxisAngle(matrices, fromMatrices, valid);
+        batch::convertToMatrix(fromMatrices, backMatrices, backValid);
+        failed = failed or std::count(valid.begin(), valid.end(), 1) != static_cast<long>(matrices.size());
+        for(std::size_t i = 0; i < matrices.size(); ++i){
+            failed = failed or fromMatrices.angle()[i] < 0 or fromMatrices.angle()[i] > pi + 1e-12
+                            or !areEqual(matrices[i], backMatrices[i], 1e-12);
+        }
+        if(failed){
+            numErrors++;
+            std::cout << "batch conversions to axis-angle failed \n";
+        }
+    }
+    // Invalid entries are flagged in the mask, valid neighbours are not
+    {
+        QuaternionArray<double> q;
+        q.push_back({1., 0., 0., 0.});
+        q.push_back({2., 0., 0., 0.});
+        AxisAngleArray<double> a;
+        batch::convertToAxisAngle(q, a, valid);
+        if(valid != ValidityMask{1, 0}){
+            numErrors++;
+            std::cout << "batch quaternion validity failed \n";
+        }
+        MatrixArray<double> M;
+        M.push_back(Matrix3<double>({1., 0., 0., 0., 1., 0., 0., 0., 1.}));
+        M.push_back(Matrix3<double>({1., 2., 3., 4., 5., 6., 7., 8., 9.}));
+        M.push_back(Matrix3<double>({1., 0., 0., 0., 0., -1., 0., 1., 0.}));
+        QuaternionArray<double> fromM;
+        batch::convertToQuaternion(M, fromM, valid);
+        ValidityMask toAxisAngle;
+        batch::convertToAxisAngle(M, a, toAxisAngle);
+        if(valid != ValidityMask{1, 0, 1} or toAxisAngle != ValidityMask{0, 0, 1}){ // the identity has no axis
+            numErrors++;
+            std::cout << "batch matrix validity failed \n";
+        }
+        AxisAngleArray<double> b;
+        b.push_back(axisAngle<double>({0., 0., 0.}, 1.));
+        b.push_back(axisAngle<double>({1., 0., 0.}, 0.));
+        b.push_back(axisAngle<double>({1., 0., 0.}, 1.));
+        batch::convertToQuaternion(b, fromM, valid);
+        if(valid != ValidityMask{0, 0, 1}){
+            numErrors++;
+            std::cout << "batch axis-angle validity failed \n";
+        }
+    }
+    // float round trip
+    {
+        AxisAngleArray<float> a;
+        for(std::size_t i = 0; i < axisAngles.size(); ++i){
+            a.push_back(axisAngle<float>(static_cast<float>(axisAngles.x()[i]), static_cast<float>(axisAngles.y()[i]),
+                                         static_cast<float>(axisAngles.z()[i]), static_cast<float>(axisAngles.angle()[i])));
+        }
+        QuaternionArray<float> q, back;
+        MatrixArray<float> M;
+        batch::convertToQuaternion(a, q, valid);
+        batch::convertToMatrix(q, M);
+        batch::convertToQuaternion(M, back, valid);
+        bool failed = std::count(valid.begin(), valid.end(), 1) != static_cast<long>(a.size());
+        for(std::size_t i = 0; i < q.size(); ++i){
+            float sign = q.w()[i] < 0 ? -1.f : 1.f;
+            failed = failed or !areEqual(std::array<float, 4>{sign*q.w()[i], sign*q.x()[i], sign*q.y()[i], sign*q.z()[i]}, back[i], 1e-5);
+        }
+        if(failed){
+            numErrors++;
+            std::cout << "batch float conversions failed \n";
+        }
+    }
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include <iostream>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "quaternion.hpp"
+#include "matrix.hpp"
+#include "points.hpp"
+#include "parallel.hpp"
+#include "rotationArrays.hpp"
+#include "batchRotation.hpp"
+#include "test.hpp"
+
+void TestBatchRotation(){
+    int numErrors = 0;
+    const std::vector<std::array<double,3>> raw = oddSizedCloud();
+    QuaternionArray<double> q;
+    MatrixArray<double> M;
+    for(std::size_t i = 0; i < raw.size(); ++i){
+        const quaternion<double> unit = UnitQuaternion<double>::fromQuaternion({std::cos(0.7*i), 0.3, std::sin(0.2*i), -0.4}).value().value();
+        q.push_back(i % 100 == 7 ? 2.*unit : unit); // a few that are not rotations
+        M.push_back(i % 100 == 42 ? Matrix3<double>({1., 0.5, 0., 0., 1., 0., 0., 0., 1.}) // shears: det 1, not rotations
+                                  : (i % 100 == 7 ? 2.*unit : unit).convertToMatrix());
+    }
+    const Points<double> cloud(raw);
+    ThreadPool pool(4);
+    // Point i by quaternion i, same as rotateByQuaternion point by point; the pool and in place give the same result
+    {
+        Points<double> rotated, pooled, inPlace = cloud;
+        ValidityMask valid, validPooled, validInPlace;
+        bool failed = !batch::rotate(q, cloud, rotated, valid) or !batch::rotate(q, cloud, pooled, validPooled, {&pool, 100})
+                      or !batch::rotate(q, inPlace, inPlace, validInPlace) or rotated.size() != raw.size() or valid.size() != raw.size();
+        for(std::size_t i = 0; !failed and i < raw.size(); ++i){
+            auto expected = rotateByQuaternion(q[i], raw[i]);
+            failed = static_cast<bool>(valid[i]) != static_cast<bool>(expected) or (expected and !areEqual(*expected, rotated[i], 1e-14))
+                     or !areEqual(rotated[i], pooled[i], 1e-15) or !areEqual(rotated[i], inPlace[i], 1e-15)
+                     or valid[i] != validPooled[i] or valid[i] != validInPlace[i];
+        }
+        if(failed){
+            numErrors++;
+            std::cout << "batch::rotate(QuaternionArray, Points) failed \n";
+        }
+    }
+    // Point i by matrix i, same as Matrix3 * vector
+    {
+        Points<double> rotated, pooled;
+        ValidityMask valid, validPooled;
+        bool failed = !batch::rotate(M, cloud, rotated, valid) or !batch::rotate(M, cloud, pooled, validPooled, {&pool, 100}) or valid[42] != 0;
+        for(std::size_t i = 0; !failed and i < raw.size(); ++i){
+            auto expected = M[i]*raw[i];
+            failed = static_cast<bool>(valid[i]) != static_cast<bool>(expected) or (expected and !areEqual(*expected, rotated[i], 1e-14))
+                     or !areEqual(rotated[i], pooled[i], 1e-15) or valid[i] != validPooled[i];
+        }
+        if(failed){
+            numErrors++;
+            std::cout << "batch::rotate(MatrixArray, Points) failed \n";
+        }
+    }
+    // Blends of 1 to 5 rotations per point out of a palette, against the sum of the rotated points
+    {
+        MatrixArray<double> palette;
+        for(int b = 0; b < 7; ++b){
+            palette.push_back(M[static_cast<std::size_t>(b)]);
+        }
+        bool failed = false;
+        for(std::size_t perPoint = 1; perPoint <= 5; ++perPoint){
+            std::vector<std::uint32_t> index;
+            std::vector<double> weight;
+            for(std::size_t i = 0; i < raw.size(); ++i){
+                for(std::size_t k = 0; k < perPoint; ++k){
+                    index.push_back(static_cast<std::uint32_t>((3*i + 5*k) % palette.size()));
+                    weight.push_back(static_cast<double>(k + 1)/static_cast<double>(perPoint*(perPoint + 1)/2));
+                }
+            }
+            Points<double> blended, pooled;
+            failed = failed or !batch::blend(palette, index, weight, perPoint, cloud, blended)
+                     or !batch::blend(palette, index, weight, perPoint, cloud, pooled, {&pool, 100});
+            for(std::size_t i = 0; !failed and i < raw.size(); ++i){
+                std::array<double,3> expected{0., 0., 0.};
+                for(std::size_t k = 0; k < perPoint; ++k){
+                    const std::array<double,3> r = *(palette[index[i*perPoint + k]]*raw[i]);
+                    for(int c = 0; c < 3; ++c){
+                        expected[c] += weight[i*perPoint + k]*r[c];
+                    }
+                }
+                failed = !areEqual(expected, blended[i], 1e-14) or !areEqual(blended[i], pooled[i], 1e-15);
+            }
+            if(perPoint == 3){ // bad inputs are rejected, out untouched
+                Points<double> untouched = cloud;
+                index[10] = 7;
+                failed = failed or batch::blend(palette, index, weight, perPoint, cloud, untouched)
+                         or batch::blend(palette, index, weight, 2, cloud, untouched) or batch::blend(palette, index, weight, 0, cloud, untouched)
+                         or !areEqual(untouched[0], raw[0], 1e-15);
+            }
+        }
+        if(failed){
+            numErrors++;
+            std::cout << "batch::blend failed \n";
+        }
+    }
+    // Size mismatches are rejected
+    {
+        Points<double> out;
+        ValidityMask valid;
+        QuaternionArray<double> shorter(raw.size() - 1);
+        MatrixArray<double> longer(raw.size() + 1);
+        if(batch::rotate(shorter, cloud, out, valid) or batch::rotate(longer, cloud, out, valid) or out.size() != 0 or valid.size() != 0){
+            numErrors++;
+            std::cout << "batch::rotate accepted arrays of different sizes \n";
+        }
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <iostream>
+#include <array>
+#include <cmath>
+#include "quaternion.hpp"
+#include "matrix.hpp"
+#include "axisAngle.hpp"
+#include "test.hpp"
+
+template<typename K, typename F>
+constexpr bool areEqualConstexpr(const K &reference, const F &value, double precision) {
+    for(decltype(reference.size()) i = 0; i < reference.size(); ++i){
+        double difference = reference[i] - value[i];
+        if(!(difference <= precision and difference >= -precision)){
+            return false;
+        }
+    }
+    return true;
+}
+
+// A fixed sensor mount, built and applied at compile time: 90 degrees around x, then 90 degrees around z
+constexpr UnitQuaternion<double> mountX = UnitQuaternion<double>::fromQuaternion({1., 1., 0., 0.}).value();
+constexpr UnitQuaternion<double> mountZ = UnitQuaternion<double>::fromQuaternion({1., 0., 0., 1.}).value();
+constexpr UnitQuaternion<double> mount = mountZ*mountX;
+constexpr RotationMatrix<double> mountMatrix = mount.convertToMatrix();
+constexpr std::array<double, 3> mounted = mount*std::array<double, 3>{1., 1., 0.};
+
+void TestConstexpr(){
+    int numErrors = 0;
+    // Everything below is checked by the compiler
+    {
+        static_assert(detail::sqrt(4.) == 2. and detail::sqrt(0.) == 0., "constexpr sqrt failed");
+        static_assert(areEqualConstexpr(std::array<double, 1>{1.4142135623730951}, std::array<double, 1>{detail::sqrt(2.)}, 1e-15), "constexpr sqrt failed");
+        static_assert(!UnitQuaternion<double>::fromQuaternion({0., 0., 0., 0.}), "zero quaternion normalized");
+
+        // i*j = k
+        constexpr quaternion<double> k = quaternion<double>{0., 1., 0., 0.}*quaternion<double>{0., 0., 1., 0.};
+        static_assert(k.w() == 0. and k.x() == 0. and k.y() == 0. and k.z() == 1., "constexpr quaternion product failed");
+        static_assert(k.inv().z() == -1., "constexpr quaternion inverse failed");
+
+        // (1, 1, 0) -> (1, 0, 1) -> (0, 1, 1)
+        static_assert(areEqualConstexpr(std::array<double, 3>{0., 1., 1.}, mounted, 1e-15), "constexpr UnitQuaternion apply failed");
+        static_assert(areEqualConstexpr(mounted, mountMatrix*std::array<double, 3>{1., 1., 0.}, 1e-14), "constexpr RotationMatrix apply failed");
+        static_assert(areEqualConstexpr(std::array<double, 3>{1., 1., 0.}, mount.inv()*mounted, 1e-14), "constexpr UnitQuaternion inverse failed");
+        static_assert(areEqualConstexpr(std::array<double, 3>{1., 1., 0.}, mountMatrix.inv()*mounted, 1e-14), "constexpr RotationMatrix inverse failed");
+
+        // The same with plain matrices: a quarter turn around z, four times, is the identity
+        constexpr Matrix3<double> quarter({0., -1., 0., 1., 0., 0., 0., 0., 1.});
+        constexpr Matrix3<double> full = quarter*quarter*quarter*quarter;
+        static_assert(areEqualConstexpr(std::array<double, 9>{1., 0., 0., 0., 1., 0., 0., 0., 1.}, full, 0.), "constexpr matrix product failed");
+        static_assert(quarter.isRotation() and !Matrix3<double>().isRotation(), "constexpr isRotation failed");
+        static_assert(areEqualConstexpr(std::array<double, 3>{-2., 1., 3.}, *(quarter*std::array<double, 3>{1., 2., 3.}), 0.), "constexpr matrix rotation failed");
+        static_assert(areEqualConstexpr(std::array<double, 3>{1., 2., 3.}, *(quarter*quarter*quarter*quarter*std::array<double, 3>{1., 2., 3.}), 0.), "constexpr lazy matrix product failed");
+        constexpr RotationMatrix<double> quarterRotation = RotationMatrix<double>::fromMatrix(quarter).value();
+        static_assert(areEqualConstexpr(full, (quarterRotation*quarterRotation*quarterRotation*quarterRotation).value(), 0.), "constexpr RotationMatrix product failed");
+        static_assert(!RotationMatrix<double>::fromMatrix(Matrix3<double>()), "zero matrix accepted as a rotation");
+
+        constexpr axisAngle<double> a({1., 0., 0.}, 0.5);
+        static_assert(a.isRotation() and !axisAngle<double>().isRotation() and a.getAngle() == 0.5, "constexpr axisAngle failed");
+    }
+    // Compile-time and run-time construction agree
+    {
+        quaternion<double> runtimeInput{1., 1., 0., 0.};
+        UnitQuaternion<double> runtimeMount = UnitQuaternion<double>::fromQuaternion(runtimeInput).value();
+        if(!areEqual(mountX.value(), runtimeMount.value(), 1e-15)){
+            numErrors++;
+            std::cout << "constexpr and run-time UnitQuaternion differ \n";
+        }
+    }
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <iostream>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include "quaternion.hpp"
+#include "matrix.hpp"
+#include "axisAngle.hpp"
+#include "fastMath.hpp"
+#include "test.hpp"
+
+// Largest |FastTrig - std| over evenly spaced arguments in [-range, range], and at small angles around the Taylor branch
+template<typename T>
+double fastTrigError(T range, int samples) {
+    double error = 0;
+    auto check = [&error](T x){
+        T s, c;
+        FastTrig::sincos(x, s, c);
+        const T t = FastTrig::atan2(x, T(1)), u = FastTrig::atan2(x, T(-2));
+        error = std::max({error, std::abs(static_cast<double>(s) - std::sin(static_cast<double>(x))),
+                                 std::abs(static_cast<double>(c) - std::cos(static_cast<double>(x))),
+                                 std::abs(static_cast<double>(t) - std::atan2(static_cast<double>(x), 1.)),
+                                 std::abs(static_cast<double>(u) - std::atan2(static_cast<double>(x), -2.))});
+    };
+    for(int i = 0; i <= samples; ++i){
+        check(static_cast<T>(-range + 2*range*static_cast<T>(i)/static_cast<T>(samples)));
+        check(static_cast<T>(2*FastTrig::smallAngle<T>*static_cast<T>(i)/static_cast<T>(samples)));
+    }
+    return error;
+}
+
+void TestFastTrig(){
+    int numErrors = 0;
+    // FastTrig against the std:: functions, at the bounds documented in fastMath.hpp
+    {
+        if(fastTrigError(10., 100001) > 5e-16 or fastTrigError(10.f, 100001) > 3e-7){
+            numErrors++;
+            std::cout << "FastTrig is not accurate enough: " << fastTrigError(10., 100001) << " " << fastTrigError(10.f, 100001) << " \n";
+        }
+    }
+    // Huge, infinite and NaN arguments go to the std:: functions
+    {
+        auto same = [](double a, double b){ return a == b or (std::isnan(a) and std::isnan(b)); };
+        bool failed = false;
+        for(double x : {1e300, -3e7, std::numeric_limits<double>::infinity(), std::numeric_limits<double>::quiet_NaN()}){
+            double s, c;
+            FastTrig::sincos(x, s, c);
+            failed = failed or !same(s, std::sin(x)) or !same(c, std::cos(x));
+        }
+        float s, c;
+        FastTrig::sincos(1e30f, s, c);
+        failed = failed or s != std::sin(1e30f) or c != std::cos(1e30f);
+        if(failed){
+            numErrors++;
+            std::cout << "FastTrig::sincos of a huge or non-finite argument failed \n";
+        }
+    }
+    // Conversions with FastTrig agree with StdTrig, from tiny angles to almost pi
+    {
+        bool failed = false;
+        for(double angle : {1e-12, 1e-6, 0.02, 0.5, 1.9, 3.1}){
+            axisAngle<double> a({0.48, 0.6, 0.64}, angle);
+            auto q = a.convertToQuaternion(), qFast = a.convertToQuaternion<FastTrig>();
+            auto m = a.convertToMatrix(), mFast = a.convertToMatrix<FastTrig>();
+            auto back = q->convertToAxisAngle(), backFast = q->convertToAxisAngle<FastTrig>();
+            auto fromMatrix = m->convertToAxisAngle(), fromMatrixFast = m->convertToAxisAngle<FastTrig>();
+            failed = failed or !areEqual(*q, *qFast, 1e-15) or !areEqual(*m, *mFast, 1e-15)
+                     or std::abs(back->getAngle() - angle) > 1e-15*std::max(1., angle) or std::abs(backFast->getAngle() - angle) > 1e-15*std::max(1., angle)
+                     or std::abs(fromMatrix->getAngle() - fromMatrixFast->getAngle()) > 1e-15;
+            if(angle > 1e-6){ // the matrix holds the angle to about 1e-16 absolute
+                failed = failed or std::abs(fromMatrix->getAngle() - angle) > 1e-14;
+            }
+        }
+        if(failed){
+            numErrors++;
+            std::cout << "FastTrig conversions failed \n";
+        }
+    }
+    // Small angles keep their relative accuracy: the quaternion's sin(angle/2) is not divided out, and the matrix's 1 - cos does not cancel
+    {
+        const double angle = 1e-9;
+        axisAngle<double> a({0., 0., 1.}, angle);
+        auto back = a.convertToQuaternion<FastTrig>()->convertToAxisAngle<FastTrig>();
+        Matrix3<double> m = *a.convertToMatrix();
+        Matrix3<double> tilted = *axisAngle<double>({0.6, 0., 0.8}, angle).convertToMatrix();
+        if(std::abs(back->getAngle() - angle) > 1e-24 or back->z() != 1. or m(1, 0) != std::sin(angle)
+           or std::abs(tilted(0, 2) - 0.48*angle*angle/2) > 1e-15*0.48*angle*angle/2){ // x z (1 - cos)
+            numErrors++;
+            std::cout << "small angle conversions failed \n";
+        }
+    }
+    // Matrix -> axis-angle for angles beyond pi/2 (asin would fold them back)
+    {
+        auto a = axisAngle<double>({0., 1., 0.}, 2.5).convertToMatrix()->convertToAxisAngle();
+        if(!a or std::abs(a->getAngle() - 2.5) > 1e-14 or std::abs(a->y() - 1.) > 1e-14){
+            numErrors++;
+            std::cout << "matrix -> axis-angle conversion beyond pi/2 failed \n";
+        }
+    }
+}
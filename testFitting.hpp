@@ -0,0 +1,127 @@
+#pragma once
+#include <iostream>
+#include <cmath>
+#include <vector>
+#include "quaternion.hpp"
+#include "matrix.hpp"
+#include "points.hpp"
+#include "parallel.hpp"
+#include "rigidTransform.hpp"
+#include "eigen4.hpp"
+#include "fitting.hpp"
+#include "test.hpp"
+
+void TestFitting(){
+    int numErrors = 0;
+    // The Jacobi eigen solver: V diag V^T gives back the matrix, V is orthonormal, eigenvalues in decreasing order
+    {
+        const detail::Matrix4<double> a{{{4., 1., -2., 0.5}, {1., 3., 0.25, 1e-9}, {-2., 0.25, -1., 2.}, {0.5, 1e-9, 2., 3.}}};
+        std::array<double,4> values;
+        detail::Matrix4<double> V;
+        detail::symmetricEigen4(a, values, V);
+        double error = 0;
+        for(int i = 0; i < 4; ++i){
+            for(int j = 0; j < 4; ++j){
+                double product = 0, orthogonality = 0;
+                for(int k = 0; k < 4; ++k){
+                    product += V[i][k]*values[k]*V[j][k];
+                    orthogonality += V[k][i]*V[k][j];
+                }
+                error = std::max({error, std::abs(product - a[i][j]), std::abs(orthogonality - (i == j ? 1. : 0.))});
+            }
+        }
+        if(error > 1e-14 or !(values[0] >= values[1] and values[1] >= values[2] and values[2] >= values[3])){
+            numErrors++;
+            std::cout << "symmetricEigen4 failed: " << error << " \n";
+        }
+    }
+    const std::vector<std::array<double,3>> raw = oddSizedCloud();
+    const Points<double> cloud(raw);
+    // Exact data: the rotation and translation are recovered, serially, on a pool (whatever its size), and far from the origin
+    {
+        const UnitQuaternion<double> r = UnitQuaternion<double>::fromQuaternion({0.3, -0.5, 0.7, 0.2}).value();
+        const RigidTransform<double> X(r, {1., -2., 3.}), far(r, {1e6, -2e6, 3e6});
+        ThreadPool pool4(4), pool2(2);
+        const auto fit = fitRigidTransform(cloud, cloud.transform(X));
+        const auto fit4 = fitRigidTransform(cloud, cloud.transform(X), {&pool4, 100});
+        const auto fit2 = fitRigidTransform(cloud, cloud.transform(X), {&pool2, 100});
+        const auto fitFar = fitRigidTransform(cloud.transform(far), cloud.transform(far*X*far.inv()).transform(far));
+        const auto rotation = fitRotation(cloud, cloud.transform(RigidTransform<double>(r)));
+        if(!fit or !fit4 or !fit2 or !fitFar or !rotation or quaternionDistance(fit->rotation(), r) > 1e-14 or !areEqual(fit->translation(), X.translation(), 1e-13)
+           or quaternionDistance(fit4->rotation(), r) > 1e-14 or fit4->rotation().w() != fit2->rotation().w() or fit4->translation() != fit2->translation()
+           or quaternionDistance(fitFar->rotation(), r) > 1e-9 or quaternionDistance(*rotation, r) > 1e-14){
+            numErrors++;
+            std::cout << "fitRigidTransform or fitRotation did not recover the transform \n";
+        }
+    }
+    // Rotation by pi, and float points
+    {
+        const UnitQuaternion<double> half = UnitQuaternion<double>::fromQuaternion({0., 0.6, 0., 0.8}).value();
+        const auto fit = fitRotation(cloud, cloud.transform(RigidTransform<double>(half)));
+        std::vector<std::array<float,3>> rawFloat;
+        for(const auto &p : raw){
+            rawFloat.push_back({static_cast<float>(p[0]), static_cast<float>(p[1]), static_cast<float>(p[2])});
+        }
+        const Points<float> cloudFloat(rawFloat);
+        const UnitQuaternion<float> r = UnitQuaternion<float>::fromQuaternion({0.3f, -0.5f, 0.7f, 0.2f}).value();
+        const auto fitFloat = fitRigidTransform(cloudFloat, cloudFloat.transform(RigidTransform<float>(r, {1.f, 2.f, 3.f})));
+        if(!fit or quaternionDistance(*fit, half) > 1e-14 or !fitFloat or quaternionDistance(fitFloat->rotation(), r) > 1e-6){
+            numErrors++;
+            std::cout << "fitRotation by pi or in float failed \n";
+        }
+    }
+    // Noisy data: the fit is a minimum of the squared distance
+    {
+        const UnitQuaternion<double> r = UnitQuaternion<double>::fromQuaternion({0.9, 0.1, -0.3, 0.2}).value();
+        Points<double> noisy = cloud.transform(RigidTransform<double>(r, {0.5, 0., 0.}));
+        for(std::size_t i = 0; i < noisy.size(); ++i){
+            noisy.x()[i] += 0.01*std::sin(17.*i);
+            noisy.z()[i] += 0.01*std::cos(5.*i);
+        }
+        const auto fit = fitRigidTransform(cloud, noisy);
+        auto squaredDistance = [&](const RigidTransform<double> &X){
+            const Points<double> moved = cloud.transform(X);
+            double sum = 0;
+            for(std::size_t i = 0; i < moved.size(); ++i){
+                for(int c = 0; c < 3; ++c){
+                    sum += (moved[i][c] - noisy[i][c])*(moved[i][c] - noisy[i][c]);
+                }
+            }
+            return sum;
+        };
+        bool failed = !fit;
+        for(int k = 0; fit and k < 6; ++k){
+            const std::array<double,3> axis{k % 3 == 0 ? 1. : 0., k % 3 == 1 ? 1. : 0., k % 3 == 2 ? 1. : 0.};
+            const double angle = k < 3 ? 1e-3 : -1e-3;
+            const UnitQuaternion<double> nudge = UnitQuaternion<double>::fromQuaternion({std::cos(angle/2), std::sin(angle/2)*axis[0], std::sin(angle/2)*axis[1], std::sin(angle/2)*axis[2]}).value();
+            const RigidTransform<double> nudged(nudge*fit->rotation(), {fit->translation()[0] + 1e-3*axis[0], fit->translation()[1], fit->translation()[2]});
+            failed = failed or !(squaredDistance(nudged) > squaredDistance(*fit));
+        }
+        if(failed){
+            numErrors++;
+            std::cout << "fitRigidTransform is not the least-squares fit \n";
+        }
+    }
+    // The ellipse against its rotated copy (the example of main.cpp)
+    {
+        const Points<double> ellipse("ellipse.dat");
+        const UnitQuaternion<double> r = UnitQuaternion<double>::fromQuaternion(*axisAngle<double>({1./std::sqrt(2), 1./std::sqrt(2), 0.}, 45.).convertToQuaternion()).value();
+        const auto fit = fitRotation(ellipse, ellipse.rotate(r));
+        if(ellipse.size() == 0 or !fit or quaternionDistance(*fit, r) > 1e-12){
+            numErrors++;
+            std::cout << "fitRotation of the ellipse failed \n";
+        }
+    }
+    // Sets of different sizes, or that do not determine the rotation, are rejected
+    {
+        std::vector<std::array<double,3>> line;
+        for(int i = 0; i < 10; ++i){
+            line.push_back({1.*i, 2.*i, -1.*i});
+        }
+        const Points<double> points(line), single(std::vector<std::array<double,3>>{{1., 2., 3.}});
+        if(fitRigidTransform(points, points) or fitRigidTransform(single, single) or fitRigidTransform(cloud, points) or fitRotation(Points<double>(), Points<double>())){
+            numErrors++;
+            std::cout << "fitting accepted a degenerate problem \n";
+        }
+    }
+}
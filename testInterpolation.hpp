@@ -0,0 +1,122 @@
+#pragma once
+#include <iostream>
+#include <cmath>
+#include <vector>
+#include "quaternion.hpp"
+#include "rotationArrays.hpp"
+#include "interpolation.hpp"
+#include "test.hpp"
+
+void TestInterpolation(){
+    int numErrors = 0;
+    auto aroundZ = [](double angle){ return quaternion<double>{std::cos(angle/2), 0., 0., std::sin(angle/2)}; };
+    // slerp turns at constant angular velocity, along the shorter arc
+    {
+        quaternion<double> a = aroundZ(0.2), b = aroundZ(2.2);
+        quaternion<double> minusB{-b.w(), -b.x(), -b.y(), -b.z()};
+        bool failed = false;
+        for(double t = 0.; t <= 1.; t += 0.125){
+            failed = failed or !areEqual(aroundZ(0.2 + 2*t), *slerp(a, b, t), 1e-15) or !areEqual(aroundZ(0.2 + 2*t), *slerp(a, minusB, t), 1e-15);
+        }
+        UnitQuaternion<double> ua = UnitQuaternion<double>::fromQuaternion(a).value(), ub = UnitQuaternion<double>::fromQuaternion(b).value();
+        if(failed or !areEqual(aroundZ(1.2), slerp(ua, ub, 0.5).value(), 1e-15) or slerp(a, quaternion<double>{1., 1., 0., 0.}, 0.5)){
+            numErrors++;
+            std::cout << "slerp failed \n";
+        }
+    }
+    // nlerp stays within about arc^3/(18 sqrt 3) of slerp
+    {
+        quaternion<double> a = *axisAngle<double>({0.48, 0.6, 0.64}, 0.3).convertToQuaternion();
+        quaternion<double> b = *axisAngle<double>({0., 0.6, 0.8}, -0.5).convertToQuaternion();
+        const double arc = std::acos(a.w()*b.w() + a.x()*b.x() + a.y()*b.y() + a.z()*b.z());
+        double maxError = 0.;
+        for(double t = 0.; t <= 1.; t += 1./64){
+            quaternion<double> n = *nlerp(a, b, t), s = *slerp(a, b, t);
+            maxError = std::max(maxError, 2*std::acos(std::min(1., std::abs(n.w()*s.w() + n.x()*s.x() + n.y()*s.y() + n.z()*s.z()))));
+        }
+        if(!nlerp(a, b, 0.3)->isRotation() or maxError > 0.0326*arc*arc*arc or maxError < 1e-6){
+            numErrors++;
+            std::cout << "nlerp error out of bound: " << maxError << " \n";
+        }
+    }
+    // squad goes through the keys, and is slerp when the control points are the keys
+    {
+        quaternion<double> q0 = aroundZ(0.1), q1 = *axisAngle<double>({0.6, 0., 0.8}, 0.7).convertToQuaternion(), q2 = aroundZ(1.5);
+        quaternion<double> s1 = *squadControlPoint(q0, q1, q2);
+        if(!areEqual(q0, *squad(q0, q1, q0, s1, 0.), 1e-15) or !areEqual(q1, *squad(q0, q1, q0, s1, 1.), 1e-15)
+           or !squad(q0, q1, q0, s1, 0.4)->isRotation() or !areEqual(*slerp(q0, q1, 0.3), *squad(q0, q1, q0, q1, 0.3), 1e-15)){
+            numErrors++;
+            std::cout << "squad failed \n";
+        }
+    }
+    // Resampling a track on a dense grid agrees with the scalar interpolation of every sample
+    {
+        std::vector<double> keyTimes;
+        QuaternionArray<double> keys;
+        for(int k = 0; k < 12; ++k){
+            keyTimes.push_back(0.5*k + 0.01*k*k);
+            // alternate signs: the resampler must take the shorter arcs; the last segments are too short for nlerp
+            quaternion<double> key = *axisAngle<double>({0.8*std::cos(0.4*k), 0.8*std::sin(0.4*k), 0.6}, k < 9 ? 0.05 + 0.02*k : 0.5*k).convertToQuaternion();
+            keys.push_back(k % 2 ? quaternion<double>{-key.w(), -key.x(), -key.y(), -key.z()} : key);
+        }
+        std::vector<double> times;
+        for(int i = 0; i < 2000; ++i){
+            times.push_back(-0.5 + 0.004*i);
+        }
+        QuaternionArray<double> out, exact, smooth;
+        batch::resample(keyTimes, keys, times, out);
+        batch::resample(keyTimes, keys, times, exact, batch::Interpolation::slerp, 0.);
+        batch::resample(keyTimes, keys, times, smooth, batch::Interpolation::squad);
+
+        std::vector<quaternion<double>> hemisphere{keys[0]};
+        for(std::size_t k = 1; k < keys.size(); ++k){
+            hemisphere.push_back(detail::shorterArc(hemisphere.back(), keys[k]));
+        }
+        std::vector<quaternion<double>> controls = hemisphere;
+        for(std::size_t k = 1; k + 1 < hemisphere.size(); ++k){
+            controls[k] = *squadControlPoint(hemisphere[k - 1], hemisphere[k], hemisphere[k + 1]);
+        }
+        auto angle = [](const quaternion<double> &p, const quaternion<double> &q){
+            return 2*std::acos(std::min(1., std::abs(p.w()*q.w() + p.x()*q.x() + p.y()*q.y() + p.z()*q.z())));
+        };
+        double maxError = 0., maxExactError = 0., maxSquadError = 0.;
+        bool failed = out.size() != times.size() or exact.size() != times.size() or smooth.size() != times.size();
+        for(std::size_t i = 0; i < times.size() and !failed; ++i){
+            std::size_t k = 0;
+            while(k + 2 < keyTimes.size() and times[i] >= keyTimes[k + 1]){
+                ++k;
+            }
+            const double t = std::min(std::max((times[i] - keyTimes[k])/(keyTimes[k + 1] - keyTimes[k]), 0.), 1.);
+            quaternion<double> reference = *slerp(hemisphere[k], hemisphere[k + 1], t);
+            maxError = std::max(maxError, angle(reference, out[i]));
+            maxExactError = std::max(maxExactError, angle(reference, exact[i]));
+            maxSquadError = std::max(maxSquadError, angle(*squad(hemisphere[k], hemisphere[k + 1], controls[k], controls[k + 1], t), smooth[i]));
+            failed = !out[i].isRotation() or !smooth[i].isRotation();
+        }
+        if(failed or maxError > 1e-6 or maxExactError > 1e-7 or maxSquadError > 1e-7 or !areEqual(keys[0], out[0], 1e-15)
+           or !areEqual(hemisphere.back(), out[times.size() - 1], 1e-15)){
+            numErrors++;
+            std::cout << "resample failed: " << failed << " " << maxError << " " << maxExactError << " " << maxSquadError << " \n";
+        }
+        // one key: constant; no keys: empty
+        QuaternionArray<double> one;
+        one.push_back(keys[3]);
+        batch::resample(std::vector<double>{1.}, one, times, out);
+        batch::resample(std::vector<double>{}, QuaternionArray<double>(), times, exact);
+        if(out.size() != times.size() or !areEqual(keys[3], out[times.size()/2], 1e-15) or exact.size() != 0){
+            numErrors++;
+            std::cout << "resample of degenerate tracks failed \n";
+        }
+        // key times that repeat, go back or are NaN are rejected (a zero-length segment would give 0/0)
+        QuaternionArray<double> three, untouched = out;
+        three.push_back(keys[0]);
+        three.push_back(keys[1]);
+        three.push_back(keys[2]);
+        if(batch::resample(std::vector<double>{0., 1., 1.}, three, times, untouched) or batch::resample(std::vector<double>{0., 2., 1.}, three, times, untouched)
+           or batch::resample(std::vector<double>{0., std::nan(""), 1.}, three, times, untouched)
+           or untouched.size() != out.size() or untouched.w()[0] != out.w()[0] or !batch::resample(std::vector<double>{0., 1., 2.}, three, times, untouched)){
+            numErrors++;
+            std::cout << "resample accepted key times that are not strictly increasing \n";
+        }
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <iostream>
+#include <cmath>
+#include <vector>
+#include <array>
+#include "matrix.hpp"
+#include "kernels.hpp"
+
+// Every instruction set available on this machine must reproduce the scalar kernel bit for bit
+template<typename T>
+int TestKernelsFor(const char *typeName){
+    int numErrors = 0;
+    const std::size_t n = 1003; // not a multiple of any vector width
+    Matrix3<T> m({T(1.), T(0.), T(0.), T(0.), T(0.1542515), T(0.9880316), T(0.), T(-0.9880316), T(0.1542515)});
+    std::vector<T> x(n), y(n), z(n);
+    std::vector<std::array<T,3>> aos(n);
+    for(std::size_t i = 0; i < n; ++i){
+        x[i] = static_cast<T>(std::sin(0.7*i));
+        y[i] = static_cast<T>(std::cos(1.3*i));
+        z[i] = static_cast<T>(0.001*i - 0.5);
+        aos[i] = {x[i], y[i], z[i]};
+    }
+    std::vector<T> xRef(n), yRef(n), zRef(n);
+    simd::rotateSoA(simd::Isa::scalar, m, x.data(), y.data(), z.data(), xRef.data(), yRef.data(), zRef.data(), n);
+    const std::array<T,3> center{T(0.25), T(-1.5), T(3.)}, offset{T(10.), T(0.5), T(-2.)};
+    std::vector<T> xMoved(n), yMoved(n), zMoved(n);
+    simd::transformSoA(simd::Isa::scalar, m, center, offset, x.data(), y.data(), z.data(), xMoved.data(), yMoved.data(), zMoved.data(), n);
+
+    for(simd::Isa isa : {simd::Isa::sse2, simd::Isa::avx2, simd::Isa::avx512}){
+        if(!simd::isSupported(isa)){
+            continue;
+        }
+        std::vector<T> xOut(n), yOut(n), zOut(n);
+        simd::rotateSoA(isa, m, x.data(), y.data(), z.data(), xOut.data(), yOut.data(), zOut.data(), n);
+        if(xOut != xRef or yOut != yRef or zOut != zRef){
+            numErrors++;
+            std::cout << "SoA kernel (" << typeName << ", isa " << static_cast<int>(isa) << ") differs from scalar \n";
+        }
+        simd::transformSoA(isa, m, center, offset, x.data(), y.data(), z.data(), xOut.data(), yOut.data(), zOut.data(), n);
+        if(xOut != xMoved or yOut != yMoved or zOut != zMoved){
+            numErrors++;
+            std::cout << "rigid transform kernel (" << typeName << ", isa " << static_cast<int>(isa) << ") differs from scalar \n";
+        }
+        std::vector<std::array<T,3>> aosOut(n);
+        simd::rotateAoS(isa, m, aos.data(), aosOut.data(), n);
+        for(std::size_t i = 0; i < n; ++i){
+            if(aosOut[i] != std::array<T,3>{xRef[i], yRef[i], zRef[i]}){
+                numErrors++;
+                std::cout << "AoS kernel (" << typeName << ", isa " << static_cast<int>(isa) << ") differs from scalar at " << i << "\n";
+                break;
+            }
+        }
+        simd::rotateAoS(isa, m, aos.data(), xOut.data(), yOut.data(), zOut.data(), n);
+        if(xOut != xRef or yOut != yRef or zOut != zRef){
+            numErrors++;
+            std::cout << "AoS to SoA kernel (" << typeName << ", isa " << static_cast<int>(isa) << ") differs from scalar \n";
+        }
+    }
+    // In place, with the dispatched kernel
+    {
+        std::vector<std::array<T,3>> inPlace = aos;
+        simd::rotateAoS(m, inPlace.data(), inPlace.data(), n);
+        if(inPlace[n - 1] != std::array<T,3>{xRef[n - 1], yRef[n - 1], zRef[n - 1]}){
+            numErrors++;
+            std::cout << "in-place AoS kernel (" << typeName << ") failed \n";
+        }
+    }
+    return numErrors;
+}
+
+void TestKernels(){
+    int numErrors = 0;
+    numErrors += TestKernelsFor<double>("double");
+    numErrors += TestKernelsFor<float>("float");
+}
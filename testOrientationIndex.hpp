@@ -0,0 +1,181 @@
+#pragma once
+#include <iostream>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include <algorithm>
+#include "quaternion.hpp"
+#include "rotationArrays.hpp"
+#include "parallel.hpp"
+#include "orientationIndex.hpp"
+#include "test.hpp"
+
+// Angle of the rotation a^-1 b, from the quaternion product (independent of the chord of the index)
+template<typename T>
+double rotationAngleBetween(const UnitQuaternion<T> &a, const UnitQuaternion<T> &b) {
+    const quaternion<T> d = (a.inv()*b).value();
+    return 2*std::atan2(std::sqrt(double(d.x())*d.x() + double(d.y())*d.y() + double(d.z())*d.z()), std::abs(double(d.w())));
+}
+
+void TestOrientationIndex(){
+    int numErrors = 0;
+    std::vector<UnitQuaternion<double>> library;
+    for(int i = 0; i < 5000; ++i){
+        library.push_back(UnitQuaternion<double>::fromQuaternion({std::sin(1.3*i + 0.2), std::cos(2.1*i), std::sin(0.7*i + 1.), std::cos(3.3*i + 0.5)}).value());
+    }
+    const OrientationIndex<double> index(library);
+    std::vector<UnitQuaternion<double>> queries;
+    for(int i = 0; i < 100; ++i){
+        queries.push_back(UnitQuaternion<double>::fromQuaternion({std::cos(0.9*i), std::sin(1.7*i + 0.3), std::cos(0.4*i + 2.), std::sin(2.9*i)}).value());
+    }
+    // k nearest and radius queries agree with brute force
+    {
+        bool failed = index.size() != library.size();
+        for(const auto &q : queries){
+            std::vector<std::pair<double, std::uint32_t>> brute;
+            for(std::size_t j = 0; j < library.size(); ++j){
+                brute.push_back({rotationAngleBetween(q, library[j]), static_cast<std::uint32_t>(j)});
+            }
+            std::sort(brute.begin(), brute.end());
+            const auto knn = index.nearest(q, 7);
+            failed = failed or knn.size() != 7;
+            for(std::size_t m = 0; m < knn.size(); ++m){
+                failed = failed or knn[m].index != brute[m].second or std::abs(knn[m].angle - brute[m].first) > 1e-12;
+            }
+            const double radius = brute[20].first;
+            const auto near = index.within(q, radius);
+            failed = failed or near.size() < 20 or near.size() > 22 or near[0].index != brute[0].second;
+            for(const auto &m : near){
+                failed = failed or rotationAngleBetween(q, library[m.index]) > radius + 1e-12;
+            }
+        }
+        if(failed){
+            numErrors++;
+            std::cout << "OrientationIndex queries differ from brute force \n";
+        }
+    }
+    // A library rotation finds itself at angle 0, also as -q (renormalized); close rotations are resolved to rounding
+    {
+        const quaternion<double> q = library[1234].value();
+        const auto self = index.nearest(library[1234]);
+        const auto negated = index.nearest(UnitQuaternion<double>::fromQuaternion({-q.w(), -q.x(), -q.y(), -q.z()}).value());
+        const UnitQuaternion<double> tiny = UnitQuaternion<double>::fromQuaternion({std::cos(5e-10), std::sin(5e-10), 0., 0.}).value(); //1e-9 radians
+        const auto close = index.nearest(library[99]*tiny);
+        if(!self or self->index != 1234 or self->angle != 0. or !negated or negated->index != 1234 or negated->angle > 1e-15
+           or !close or close->index != 99 or std::abs(close->angle - 1e-9) > 1e-15){
+            numErrors++;
+            std::cout << "OrientationIndex nearest of a library rotation failed \n";
+        }
+    }
+    // Batch queries: the same as single queries (up to the renormalization of the query), on a pool too; invalid
+    // queries are flagged
+    {
+        QuaternionArray<double> batch;
+        for(const auto &q : queries){
+            batch.push_back(q.value());
+        }
+        batch.push_back({1., 1., 0., 0.});
+        ThreadPool pool(3);
+        std::vector<OrientationMatch<double>> serial, parallel;
+        ValidityMask valid, validParallel;
+        bool failed = !index.nearest(batch, 3, serial, valid) or !index.nearest(batch, 3, parallel, validParallel, {&pool, 7})
+                      or serial.size() != 3*batch.size() or valid.back() != 0 or valid[0] != 1 or validParallel != valid
+                      or index.nearest(batch, 0, serial, valid) or index.nearest(batch, library.size() + 1, serial, valid);
+        for(std::size_t i = 0; i < queries.size(); ++i){
+            const auto single = index.nearest(queries[i], 3);
+            for(std::size_t m = 0; m < 3; ++m){
+                failed = failed or serial[3*i + m].index != single[m].index or std::abs(serial[3*i + m].angle - single[m].angle) > 1e-15
+                         or parallel[3*i + m].index != single[m].index;
+            }
+        }
+        if(failed){
+            numErrors++;
+            std::cout << "OrientationIndex batch queries failed \n";
+        }
+    }
+    // Written to a file and mapped back: the same tree, the same answers
+    {
+        const std::string filename = "test_orientations.bin";
+        bool failed = !writeBinary(index, filename);
+        const auto mapped = OrientationIndex<double>::open(filename);
+        failed = failed or !mapped or mapped->size() != index.size() or OrientationIndex<float>::open(filename)
+                 or OrientationIndex<double>::open("ellipse.dat") or OrientationIndex<double>::open("missing.bin");
+        for(std::size_t i = 0; mapped and i < queries.size(); ++i){
+            const auto a = index.nearest(queries[i], 4), b = mapped->nearest(queries[i], 4);
+            for(std::size_t m = 0; m < 4; ++m){
+                failed = failed or a[m].index != b[m].index or a[m].angle != b[m].angle;
+            }
+        }
+        // a far offset other than the one build() writes (here: past the end of the subtree) is rejected
+        {
+            std::vector<char> bytes;
+            {
+                std::ifstream input(filename, std::ios::binary);
+                bytes.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+            }
+            OrientationNode<double> node;
+            const std::size_t offset = sizeof(OrientationFileHeader) + 10*sizeof(node);
+            std::memcpy(&node, bytes.data() + offset, sizeof(node));
+            node.far = static_cast<std::uint32_t>(library.size());
+            std::memcpy(bytes.data() + offset, &node, sizeof(node));
+            std::ofstream(filename, std::ios::binary).write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+            failed = failed or OrientationIndex<double>::open(filename);
+        }
+        std::remove(filename.c_str());
+        if(failed){
+            numErrors++;
+            std::cout << "OrientationIndex file round trip failed \n";
+        }
+    }
+    // Moved, built or mapped: the new index answers as before, the moved-from one is empty
+    {
+        const std::string filename = "test_orientations_moved.bin";
+        OrientationIndex<double> built(std::vector<UnitQuaternion<double>>(library.begin(), library.begin() + 500));
+        const auto expected = built.nearest(queries[0], 3);
+        OrientationIndex<double> moved(std::move(built));
+        auto sameAsExpected = [&](const OrientationIndex<double> &other){
+            const auto match = other.nearest(queries[0], 3);
+            bool same = match.size() == expected.size();
+            for(std::size_t m = 0; same and m < match.size(); ++m){
+                same = match[m].index == expected[m].index and match[m].angle == expected[m].angle;
+            }
+            return same;
+        };
+        auto isEmpty = [&](const OrientationIndex<double> &other){
+            return other.size() == 0 and !other.data() and !other.nearest(queries[0]) and other.nearest(queries[0], 3).empty()
+                   and other.within(queries[0], 1.).empty();
+        };
+        bool failed = !isEmpty(built) or !sameAsExpected(moved) or !writeBinary(moved, filename);
+        auto mapped = OrientationIndex<double>::open(filename);
+        OrientationIndex<double> assigned(std::vector<UnitQuaternion<double>>(library.begin(), library.begin() + 10));
+        if(mapped){
+            assigned = std::move(*mapped);
+            failed = failed or !isEmpty(*mapped) or !sameAsExpected(assigned);
+        }
+        std::remove(filename.c_str());
+        if(failed or !mapped){
+            numErrors++;
+            std::cout << "OrientationIndex move failed \n";
+        }
+    }
+    // float, an empty library, and libraries with invalid rotations
+    {
+        QuaternionArray<float> floats;
+        for(std::size_t i = 0; i < 500; ++i){
+            const quaternion<double> q = library[i].value();
+            floats.push_back({float(q.w()), float(q.x()), float(q.y()), float(q.z())});
+        }
+        const auto indexFloat = OrientationIndex<float>::fromArray(floats);
+        const auto hit = indexFloat ? indexFloat->nearest(UnitQuaternion<float>::fromQuaternion(floats[321]).value()) : std::nullopt;
+        floats.push_back({0.f, 0.f, 0.f, 0.f});
+        const OrientationIndex<double> empty(std::vector<UnitQuaternion<double>>{});
+        if(!indexFloat or !hit or hit->index != 321 or hit->angle > 1e-3f or OrientationIndex<float>::fromArray(floats)
+           or empty.nearest(queries[0]) or !empty.nearest(queries[0], 3).empty() or !empty.within(queries[0], 1.).empty()){
+            numErrors++;
+            std::cout << "OrientationIndex in float or on an invalid library failed \n";
+        }
+    }
+}
@@ -0,0 +1,217 @@
+#pragma once
+#include <iostream>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include <fstream>
+#include <limits>
+#include "matrix.hpp"
+#include "points.hpp"
+#include "parallel.hpp"
+#include "pointFile.hpp"
+#include "textFormat.hpp"
+#include "pointStream.hpp"
+#include "axisAngle.hpp"
+#include <sstream>
+
+template<typename T>
+int TestPointFileRoundTrip(PointLayout layout){
+    int numErrors = 0;
+    const std::string filename = "test_points.bin";
+    Points<T> cloud;
+    for(int i = 0; i < 101; ++i){
+        cloud.push_back({static_cast<T>(std::cos(0.1*i)), static_cast<T>(std::sin(0.3*i)), static_cast<T>(0.05*i - 1.)});
+    }
+    if(!writeBinary(cloud, filename, layout)){
+        numErrors++;
+        std::cout << "writeBinary failed \n";
+    }
+    auto file = MappedPointFile::open(filename);
+    if(!file or file->size() != cloud.size() or file->layout() != layout or !file->holds<T>()){
+        numErrors++;
+        std::cout << "MappedPointFile::open failed \n";
+        return numErrors;
+    }
+    // zero-copy accessors only for the matching layout
+    if((file->x<T>() != nullptr) != (layout == PointLayout::soa) or (file->points<T>() != nullptr) != (layout == PointLayout::aos)){
+        numErrors++;
+        std::cout << "MappedPointFile layout accessors failed \n";
+    }
+    auto read = readBinary<T>(filename);
+    auto converted = readBinary<double>(filename);
+    for(std::size_t i = 0; i < cloud.size(); ++i){
+        if(read.value()[i] != cloud[i] or file->template point<T>(i) != cloud[i]){
+            numErrors++;
+            std::cout << "binary point file round trip failed at " << i << "\n";
+            break;
+        }
+        if(converted.value()[i][1] != static_cast<double>(cloud[i][1])){
+            numErrors++;
+            std::cout << "binary point file type conversion failed at " << i << "\n";
+            break;
+        }
+    }
+    // rotating straight from the file gives the same result as rotating the container
+    auto M = RotationMatrix<T>::fromMatrix(Matrix3<T>({T(1.), T(0.), T(0.), T(0.), T(0.1542515), T(0.9880316), T(0.), T(-0.9880316), T(0.1542515)}));
+    ThreadPool pool(3);
+    Points<T> fromFile = rotate(file.value(), M.value());
+    Points<T> fromFilePooled = rotate(file.value(), M.value(), {&pool, 17});
+    Points<T> fromMemory = cloud.rotate(M.value());
+    for(std::size_t i = 0; i < cloud.size(); ++i){
+        if(fromFile[i] != fromMemory[i] or fromFilePooled[i] != fromMemory[i]){
+            numErrors++;
+            std::cout << "rotation of a mapped point file failed at " << i << "\n";
+            break;
+        }
+    }
+    file.reset();
+    std::remove(filename.c_str());
+    return numErrors;
+}
+
+void TestPointFile(){
+    int numErrors = 0;
+    numErrors += TestPointFileRoundTrip<double>(PointLayout::soa);
+    numErrors += TestPointFileRoundTrip<double>(PointLayout::aos);
+    numErrors += TestPointFileRoundTrip<float>(PointLayout::soa);
+    numErrors += TestPointFileRoundTrip<float>(PointLayout::aos);
+    // text -> binary converter
+    {
+        Points<double> text("ellipse.dat");
+        if(!convertTextToBinary("ellipse.dat", "test_ellipse.bin")){
+            numErrors++;
+            std::cout << "convertTextToBinary failed \n";
+        }
+        auto binary = readBinary<double>("test_ellipse.bin");
+        if(!binary or binary->size() != text.size() or (text.size() > 0 and binary.value()[text.size() - 1] != text[text.size() - 1])){
+            numErrors++;
+            std::cout << "convertTextToBinary round trip failed \n";
+        }
+        std::remove("test_ellipse.bin");
+    }
+    // not a point file
+    if(MappedPointFile::open("ellipse.dat") or MappedPointFile::open("missing.bin")){
+        numErrors++;
+        std::cout << "MappedPointFile accepted an invalid file \n";
+    }
+}
+
+// Text format: exact round trip, block boundaries anywhere, same values as operator>>
+void TestTextFormat(){
+    int numErrors = 0;
+    {
+        Points<double> cloud;
+        cloud.push_back({1./3., -0., 1e-300});
+        cloud.push_back({std::numeric_limits<double>::denorm_min(), std::numeric_limits<double>::max(), -2.5});
+        for(int i = 0; i < 500; ++i){
+            cloud.push_back({std::cos(0.1*i), std::sin(0.3*i)*1e5, 0.05*i - 1.});
+        }
+        cloud.writeToFile("test_points.dat");
+        Points<double> read("test_points.dat");
+        TextPointReader smallBlocks("test_points.dat", 64); // forces numbers to be split between blocks
+        std::vector<double> x(cloud.size()), y(cloud.size()), z(cloud.size());
+        std::size_t n = smallBlocks.read(x.data(), y.data(), z.data(), cloud.size() + 1);
+        if(read.size() != cloud.size() or n != cloud.size()){
+            numErrors++;
+            std::cout << "text point file size mismatch \n";
+        }
+        for(std::size_t i = 0; i < std::min(n, read.size()); ++i){
+            if(read[i] != cloud[i] or std::array<double,3>{x[i], y[i], z[i]} != cloud[i] or std::signbit(read[i][1]) != std::signbit(cloud[i][1])){
+                numErrors++;
+                std::cout << "text point file round trip failed at " << i << "\n";
+                break;
+            }
+        }
+        std::remove("test_points.dat");
+    }
+    {
+        std::ofstream("test_points.dat") << "+1.5\t2 -3e2\r\n4 5 6\n7 8 nine\n10 11 12\n";
+        Points<double> read("test_points.dat");
+        if(read.size() != 2 or read[0] != std::array<double,3>{1.5, 2., -300.} or read[1] != std::array<double,3>{4., 5., 6.}){
+            numErrors++;
+            std::cout << "text point file parsing (signs, separators, invalid token) failed \n";
+        }
+        std::remove("test_points.dat");
+    }
+    {
+        std::ifstream input("ellipse.dat");
+        Points<double> parsed("ellipse.dat");
+        double x, y, z;
+        std::size_t i = 0;
+        while(input >> x >> y >> z){
+            if(i >= parsed.size() or parsed[i] != std::array<double,3>{x, y, z}){
+                numErrors++;
+                std::cout << "text parser differs from operator>> at " << i << "\n";
+                break;
+            }
+            ++i;
+        }
+        if(i != parsed.size()){
+            numErrors++;
+            std::cout << "text parser read a different number of points than operator>> \n";
+        }
+    }
+}
+
+// Streaming rotation, in chunks that do not divide the file, gives the same points as rotating in memory
+void TestPointStream(){
+    int numErrors = 0;
+    axisAngle<double> rot({1./std::sqrt(2), 1./std::sqrt(2), 0.}, 45.);
+    Points<double> ellipse("ellipse.dat");
+    Points<double> expected = ellipse.rotate(rot.convertToQuaternion());
+    auto slurp = [](const std::string &filename){
+        std::stringstream content;
+        content << std::ifstream(filename).rdbuf();
+        return content.str();
+    };
+    {
+        ThreadPool pool(3);
+        StreamOptions options;
+        options.chunkPoints = 333;
+        options.parallel = {&pool, 50};
+        auto n = rotateTextFile("ellipse.dat", "test_stream.dat", rot.convertToQuaternion(), options);
+        expected.writeToFile("test_expected.dat");
+        if(!n or n.value() != ellipse.size() or slurp("test_stream.dat") != slurp("test_expected.dat")){
+            numErrors++;
+            std::cout << "rotateTextFile differs from Points::rotate \n";
+        }
+        std::remove("test_stream.dat");
+        std::remove("test_expected.dat");
+    }
+    {
+        writeBinary(ellipse, "test_stream_in.bin", PointLayout::soa);
+        StreamOptions options;
+        options.chunkPoints = 1000;
+        auto n = rotateBinaryFile("test_stream_in.bin", "test_stream_out.bin", rot.convertToQuaternion(), options);
+        auto rotated = readBinary<double>("test_stream_out.bin");
+        if(!n or !rotated or rotated->size() != expected.size()){
+            numErrors++;
+            std::cout << "rotateBinaryFile failed \n";
+        }
+        else{
+            for(std::size_t i = 0; i < expected.size(); ++i){
+                if(rotated.value()[i] != expected[i]){
+                    numErrors++;
+                    std::cout << "rotateBinaryFile differs from Points::rotate at " << i << "\n";
+                    break;
+                }
+            }
+        }
+        if(rotateBinaryFile("test_stream_in.bin", "test_stream_out.bin", quaternion<double>{1., 1., 1., 1.})){
+            numErrors++;
+            std::cout << "rotateBinaryFile accepted a non-rotation \n";
+        }
+        // failures leave the output as it was
+        auto isKept = [&expected](){
+            auto kept = readBinary<double>("test_stream_out.bin");
+            return kept and kept->size() == expected.size();
+        };
+        if(rotateBinaryFile("missing.bin", "test_stream_out.bin", rot.convertToQuaternion()) or !isKept()
+           or rotateTextFile("missing.dat", "test_stream_out.bin", rot.convertToQuaternion()) or !isKept()){
+            numErrors++;
+            std::cout << "rotating a missing or invalid input truncated the output \n";
+        }
+        std::remove("test_stream_in.bin");
+        std::remove("test_stream_out.bin");
+    }
+}
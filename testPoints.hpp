@@ -0,0 +1,132 @@
+#pragma once
+#include <iostream>
+#include <stdexcept>
+#include <cmath>
+#include <vector>
+#include "quaternion.hpp"
+#include "matrix.hpp"
+#include "points.hpp"
+#include "parallel.hpp"
+#include "test.hpp"
+
+void TestPoints(){
+    int numErrors = 0;
+    std::vector<std::array<double,3>> raw;
+    for(int i = 0; i < 37; ++i){ // odd size, so that no kernel can assume a multiple of the vector width
+        raw.push_back({std::cos(0.1*i), std::sin(0.3*i), 0.05*i - 1.});
+    }
+    Points<double> cloud(raw);
+    quaternion<double> q{-0.7596879, 0.6502878, 0., 0.};
+    // Batch rotation must agree with rotating point by point:
+    {
+        Points<double> rotated = cloud.rotate(q);
+        if(rotated.size() != raw.size()){
+            numErrors++;
+            std::cout << "Points::rotate(quaternion) size mismatch \n";
+        }
+        for(std::size_t i = 0; i < rotated.size(); ++i){
+            auto expected = rotateByQuaternion(q, raw[i]);
+            if(!areEqual(expected.value(), rotated[i])){
+                numErrors++;
+                std::cout << "Points::rotate(quaternion) failed at " << i << "\n";
+                break;
+            }
+        }
+    }
+    {
+        Matrix3<double> m({1., 0., 0., 0. , 0.1542515 , 0.9880316, 0., -0.9880316, 0.1542515});
+        Points<double> rotated = cloud.rotate(m);
+        for(std::size_t i = 0; i < rotated.size(); ++i){
+            auto expected = m*raw[i];
+            if(!areEqual(expected.value(), rotated[i])){
+                numErrors++;
+                std::cout << "Points::rotate(matrix) failed at " << i << "\n";
+                break;
+            }
+        }
+    }
+    // In-place rotation gives the same result as the copying one:
+    {
+        Points<double> rotated = cloud.rotate(q);
+        Points<double> inPlace = cloud;
+        if(!inPlace.rotateInPlace(q)){
+            numErrors++;
+            std::cout << "Points::rotateInPlace rejected a rotation \n";
+        }
+        for(std::size_t i = 0; i < inPlace.size(); ++i){
+            if(inPlace[i] != rotated[i]){
+                numErrors++;
+                std::cout << "Points::rotateInPlace differs from Points::rotate at " << i << "\n";
+                break;
+            }
+        }
+    }
+    // Parallel rotation is identical to the serial one, for any chunk size
+    {
+        ThreadPool pool(4);
+        std::vector<int> covered(1000, 0);
+        pool.parallelFor(covered.size(), 7, [&](std::size_t begin, std::size_t end){
+            for(std::size_t i = begin; i < end; ++i){
+                covered[i]++;
+            }
+        });
+        if(std::count(covered.begin(), covered.end(), 1) != 1000){
+            numErrors++;
+            std::cout << "ThreadPool::parallelFor did not cover every index exactly once \n";
+        }
+        // an exception on any thread reaches the caller, after the job; the pool is usable afterwards
+        for(std::size_t thrower : {0, 500, 999}){
+            bool caught = false;
+            try{
+                pool.parallelFor(covered.size(), 7, [&](std::size_t begin, std::size_t end){
+                    if(begin <= thrower and thrower < end){
+                        throw std::runtime_error("chunk failed");
+                    }
+                });
+            }
+            catch(const std::runtime_error &){
+                caught = true;
+            }
+            if(!caught){
+                numErrors++;
+                std::cout << "ThreadPool::parallelFor lost an exception \n";
+            }
+        }
+        std::fill(covered.begin(), covered.end(), 0);
+        pool.parallelFor(covered.size(), 7, [&](std::size_t begin, std::size_t end){
+            for(std::size_t i = begin; i < end; ++i){
+                covered[i]++;
+            }
+        });
+        if(std::count(covered.begin(), covered.end(), 1) != 1000){
+            numErrors++;
+            std::cout << "ThreadPool::parallelFor failed after an exception \n";
+        }
+        Points<double> serial = cloud.rotate(q);
+        for(std::size_t chunk : {1, 5, 16, 1000}){
+            Points<double> parallel = cloud.rotate(q, {&pool, chunk});
+            Points<double> inPlace = cloud;
+            inPlace.rotateInPlace(q, {&pool, chunk});
+            for(std::size_t i = 0; i < serial.size(); ++i){
+                if(parallel[i] != serial[i] or inPlace[i] != serial[i]){
+                    numErrors++;
+                    std::cout << "parallel Points::rotate differs from serial (chunk " << chunk << ") at " << i << "\n";
+                    break;
+                }
+            }
+        }
+    }
+    // Not a rotation: empty result, in-place leaves the points untouched
+    {
+        quaternion<double> notRotation{-0.7596879, 99., 123., 110.};
+        if(cloud.rotate(notRotation).size() != 0){
+            numErrors++;
+            std::cout << "Points::rotate accepted a non-rotation \n";
+        }
+        Points<double> inPlace = cloud;
+        if(inPlace.rotateInPlace(notRotation) or inPlace[5] != cloud[5]){
+            numErrors++;
+            std::cout << "Points::rotateInPlace accepted a non-rotation \n";
+        }
+    }
+}
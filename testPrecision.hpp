@@ -0,0 +1,93 @@
+#pragma once
+#include <iostream>
+#include <cmath>
+#include <vector>
+#include <type_traits>
+#include "quaternion.hpp"
+#include "matrix.hpp"
+#include "axisAngle.hpp"
+#include "points.hpp"
+#include "accumulator.hpp"
+#include "test.hpp"
+
+void TestPrecision(){
+    int numErrors = 0;
+    constexpr double pi = 3.14159265358979323846;
+    static_assert(std::is_same_v<decltype(quaternion<float>().norm()), float>, "float norm is not float");
+    static_assert(std::is_same_v<decltype(quaternion<int>().norm()), double>, "integer norm is not double");
+    // float end to end: axis-angle -> quaternion -> matrix, against double
+    {
+        axisAngle<float> a({0.48f, 0.6f, 0.64f}, 0.9f);
+        axisAngle<double> b({0.48, 0.6, 0.64}, 0.9);
+        std::optional<quaternion<float>> q = a.convertToQuaternion();
+        std::optional<Matrix3<float>> m = a.convertToMatrix();
+        if(!q or !m or !q->isRotation() or !m->isRotation() or !q->convertToMatrix().isRotation()){
+            numErrors++;
+            std::cout << "float conversions are not rotations \n";
+        }
+        else if(!areEqual(*b.convertToQuaternion(), *q, 1e-6) or !areEqual(*b.convertToMatrix(), *m, 1e-6)
+                or !areEqual(*m, q->convertToMatrix(), 1e-6)){
+            numErrors++;
+            std::cout << "float conversions failed \n";
+        }
+        auto unit = UnitQuaternion<float>::fromQuaternion(*q);
+        auto rotation = RotationMatrix<float>::fromMatrix(*m);
+        std::array<float, 3> v{0.3f, -1.f, 2.f};
+        if(!unit or !rotation or !areEqual(unit.value()*v, rotation.value()*v, 1e-5)
+           or !areEqual(unit.value()*v, rotateByQuaternion(*q, v).value(), 1e-5)){
+            numErrors++;
+            std::cout << "float rotation of a vector failed \n";
+        }
+    }
+    // Scalar multiplication and division
+    {
+        quaternion<float> q{1.f, 2.f, 3.f, 4.f};
+        if(!areEqual(std::array<float, 4>{2.f, 4.f, 6.f, 8.f}, 2.f*q, 1e-7) or !areEqual(std::array<float, 4>{2.f, 4.f, 6.f, 8.f}, q*2.f, 1e-7)
+           or !areEqual(std::array<float, 4>{0.5f, 1.f, 1.5f, 2.f}, q/2.f, 1e-7)){
+            numErrors++;
+            std::cout << "quaternion scalar multiplication failed \n";
+        }
+    }
+    // Points in float, against double
+    {
+        std::vector<std::array<float, 3>> rawFloat;
+        std::vector<std::array<double, 3>> rawDouble;
+        for(int i = 0; i < 101; ++i){
+            rawFloat.push_back({std::cos(0.1f*i), std::sin(0.3f*i), 0.05f*i - 1.f});
+            rawDouble.push_back({rawFloat.back()[0], rawFloat.back()[1], rawFloat.back()[2]});
+        }
+        quaternion<double> q = *axisAngle<double>({0., 0.6, 0.8}, 2.1).convertToQuaternion();
+        quaternion<float> qf{static_cast<float>(q.w()), static_cast<float>(q.x()), static_cast<float>(q.y()), static_cast<float>(q.z())};
+        Points<float> rotatedFloat = Points<float>(rawFloat).rotate(qf);
+        Points<double> rotatedDouble = Points<double>(rawDouble).rotate(q);
+        bool failed = rotatedFloat.size() != rawFloat.size();
+        for(std::size_t i = 0; i < rotatedFloat.size() and !failed; ++i){
+            failed = !areEqual(rotatedDouble[i], rotatedFloat[i], 1e-5);
+        }
+        if(failed){
+            numErrors++;
+            std::cout << "Points<float> rotation failed \n";
+        }
+    }
+    // Mixed precision: float increments composed in double stay accurate over long chains
+    {
+        const int steps = 200000;
+        const double step = 1e-4;
+        quaternion<float> increment{static_cast<float>(std::cos(step/2)), 0.f, 0.f, static_cast<float>(std::sin(step/2))};
+        const double total = steps*std::atan2(static_cast<double>(increment.z()), static_cast<double>(increment.w()))*2;
+        RotationAccumulator<float> single;
+        RotationAccumulator<float, double> mixed;
+        for(int i = 0; i < steps; ++i){
+            single.compose(increment);
+            mixed.compose(increment);
+        }
+        auto angleError = [total](const quaternion<float> &q){
+            return std::abs(std::remainder(2*std::atan2(static_cast<double>(q.z()), static_cast<double>(q.w())) - total, 2*pi));
+        };
+        if(!mixed.value().isRotation() or !single.value().isRotation() or angleError(mixed.value()) > 1e-6
+           or angleError(mixed.value()) > angleError(single.value())){
+            numErrors++;
+            std::cout << "mixed precision accumulation failed: " << angleError(mixed.value()) << " vs " << angleError(single.value()) << " \n";
+        }
+    }
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include <iostream>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "quaternion.hpp"
+#include "rotationArrays.hpp"
+#include "parallel.hpp"
+#include "batchConversion.hpp"
+#include "randomRotations.hpp"
+#include "test.hpp"
+
+void TestRandomRotations(){
+    int numErrors = 0;
+    constexpr double pi = 3.14159265358979323846;
+    // Philox4x32-10 known answers (Random123)
+    {
+        const std::uint32_t counters[3][4] = {{0u, 0u, 0u, 0u}, {0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu}, {0x243f6a88u, 0x85a308d3u, 0x13198a2eu, 0x03707344u}};
+        const std::uint32_t keys[3][2] = {{0u, 0u}, {0xffffffffu, 0xffffffffu}, {0xa4093822u, 0x299f31d0u}};
+        const std::uint32_t expected[3][4] = {{0x6627e8d5u, 0xe169c58du, 0xbc57ac4cu, 0x9b00dbd8u}, {0x408f276du, 0x41c83b0eu, 0xa20bc7c6u, 0x6d5451fdu}, {0xd16cfe09u, 0x94fdccebu, 0x5001e420u, 0x24126ea1u}};
+        for(int t = 0; t < 3; ++t){
+            std::uint32_t c0 = counters[t][0], c1 = counters[t][1], c2 = counters[t][2], c3 = counters[t][3];
+            detail::philox4x32(c0, c1, c2, c3, keys[t][0], keys[t][1]);
+            if(c0 != expected[t][0] or c1 != expected[t][1] or c2 != expected[t][2] or c3 != expected[t][3]){
+                numErrors++;
+                std::cout << "philox4x32 known answer " << t << " failed \n";
+            }
+        }
+    }
+    // Reproducible: the same rotations serially, on pools of any size, from any first index, and one at a time
+    const std::uint64_t seed = 0x0123456789abcdefu;
+    QuaternionArray<double> q;
+    batch::uniformRotations(seed, 0, 200000, q);
+    {
+        ThreadPool pool2(2), pool3(3);
+        QuaternionArray<double> q2, q3, tail, other;
+        batch::uniformRotations(seed, 0, 200000, q2, {&pool2, 1000});
+        batch::uniformRotations(seed, 0, 200000, q3, {&pool3, 777});
+        batch::uniformRotations(seed, 150000, 50000, tail);
+        batch::uniformRotations(seed + 1, 0, 10, other);
+        bool failed = q.size() != 200000 or other[3].w() == q[3].w();
+        for(std::size_t i = 0; i < q.size(); ++i){
+            failed = failed or q2.w()[i] != q.w()[i] or q2.z()[i] != q.z()[i] or q3.x()[i] != q.x()[i] or q3.y()[i] != q.y()[i];
+        }
+        for(std::size_t i = 0; i < tail.size(); ++i){
+            failed = failed or tail.w()[i] != q.w()[150000 + i] or tail.x()[i] != q.x()[150000 + i];
+        }
+        failed = failed or !areEqual(uniformRotation<double>(seed, 123456).value(), q[123456], 1e-15);
+        if(failed){
+            numErrors++;
+            std::cout << "uniformRotations is not reproducible \n";
+        }
+    }
+    // Uniform on SO(3): unit quaternions with E[q q^T] = I/4, rotation angles with P(angle <= pi/2) = (pi/2 - 1)/pi,
+    // rotation matrices with mean 0 (the third column: directions uniform on the sphere)
+    {
+        double outer[4][4] = {};
+        std::size_t small = 0;
+        bool unit = true;
+        for(std::size_t i = 0; i < q.size(); ++i){
+            const double c[4] = {q.w()[i], q.x()[i], q.y()[i], q.z()[i]};
+            unit = unit and q[i].isRotation();
+            for(int a = 0; a < 4; ++a){
+                for(int b = 0; b < 4; ++b){
+                    outer[a][b] += c[a]*c[b]/q.size();
+                }
+            }
+            small += 2*std::acos(std::min(1., std::abs(c[0]))) <= pi/2 ? 1 : 0;
+        }
+        double error = std::abs(double(small)/q.size() - (pi/2 - 1)/pi);
+        for(int a = 0; a < 4; ++a){
+            for(int b = 0; b < 4; ++b){
+                error = std::max(error, std::abs(outer[a][b] - (a == b ? 0.25 : 0.)));
+            }
+        }
+        MatrixArray<double> M;
+        batch::uniformRotations(seed, 0, 200000, M);
+        double mean[9] = {}, zz = 0;
+        for(std::size_t i = 0; i < M.size(); ++i){
+            for(int k = 0; k < 9; ++k){
+                mean[k] += M[i][k]/M.size();
+            }
+            zz += M(2, 2)[i]*M(2, 2)[i]/M.size();
+        }
+        for(int k = 0; k < 9; ++k){
+            error = std::max(error, std::abs(mean[k]));
+        }
+        error = std::max(error, std::abs(zz - 1./3.));
+        if(!unit or error > 5e-3){
+            numErrors++;
+            std::cout << "uniformRotations is not uniform: " << error << " \n";
+        }
+    }
+    // Matrices are the matrices of the quaternions; float rotations are unit too
+    {
+        MatrixArray<double> M, fromQuaternions;
+        batch::uniformRotations(seed, 1000, 100, M);
+        QuaternionArray<double> part;
+        batch::uniformRotations(seed, 1000, 100, part);
+        batch::convertToMatrix(part, fromQuaternions);
+        bool failed = M.size() != 100;
+        for(std::size_t i = 0; i < M.size(); ++i){
+            failed = failed or !areEqual(M[i], fromQuaternions[i], 1e-15);
+        }
+        QuaternionArray<float> qFloat;
+        batch::uniformRotations(seed, 0, 1000, qFloat);
+        for(std::size_t i = 0; i < qFloat.size(); ++i){
+            failed = failed or !qFloat[i].isRotation();
+        }
+        if(failed){
+            numErrors++;
+            std::cout << "uniformRotations to matrices or in float failed \n";
+        }
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <iostream>
+#include <cmath>
+#include <vector>
+#include "quaternion.hpp"
+#include "matrix.hpp"
+#include "points.hpp"
+#include "parallel.hpp"
+#include "rigidTransform.hpp"
+#include "test.hpp"
+
+void TestRigidTransform(){
+    int numErrors = 0;
+    const UnitQuaternion<double> r1 = UnitQuaternion<double>::fromQuaternion({0.9, 0.1, -0.3, 0.2}).value();
+    const UnitQuaternion<double> r2 = UnitQuaternion<double>::fromQuaternion({-0.2, 0.7, 0.4, 0.1}).value();
+    const RigidTransform<double> a(r1, {1., -2., 0.5}), b(r2, {-3., 0.25, 4.});
+    const std::array<double,3> v{0.3, -1.2, 0.7};
+    // Composition applies b first; the inverse undoes; aboutPivot keeps the pivot fixed
+    {
+        const std::array<double,3> pivot{5., 6., -7.};
+        const RigidTransform<double> spin = RigidTransform<double>::aboutPivot(r1, pivot), spinAndMove = RigidTransform<double>::aboutPivot(r1, pivot, {1., 2., 3.});
+        const std::array<double,3> rv = r1*std::array<double,3>{v[0] - pivot[0], v[1] - pivot[1], v[2] - pivot[2]};
+        if(!areEqual((a*b)*v, a*(b*v), 1e-14) or !areEqual(a.inv()*(a*v), v, 1e-14) or !areEqual((a*a.inv())*v, v, 1e-14)
+           or !areEqual(spin*pivot, pivot, 1e-14) or !areEqual(spinAndMove*v, std::array<double,3>{rv[0] + pivot[0] + 1., rv[1] + pivot[1] + 2., rv[2] + pivot[2] + 3.}, 1e-14)
+           or !areEqual(RigidTransform<double>()*v, v, 1e-15)){
+            numErrors++;
+            std::cout << "RigidTransform composition, inverse or pivot failed \n";
+        }
+    }
+    // From a matrix: checked like RotationMatrix
+    {
+        const auto fromMatrix = RigidTransform<double>::fromMatrix(r1.convertToMatrix().value(), {1., -2., 0.5});
+        if(!fromMatrix or !areEqual(*fromMatrix*v, a*v, 1e-14) or RigidTransform<double>::fromMatrix(Matrix3<double>({1., 2., 3., 4., 5., 6., 7., 8., 9.}))){
+            numErrors++;
+            std::cout << "RigidTransform::fromMatrix failed \n";
+        }
+    }
+    // Batch: the same as point by point, on a pool and in place too
+    {
+        const std::vector<std::array<double,3>> raw = oddSizedCloud();
+        const Points<double> cloud(raw);
+        ThreadPool pool(4);
+        Points<double> moved = cloud.transform(a), pooled, inPlace = cloud;
+        cloud.transform(a, pooled, {&pool, 100});
+        inPlace.transformInPlace(a);
+        bool failed = moved.size() != raw.size();
+        for(std::size_t i = 0; !failed and i < raw.size(); ++i){
+            failed = !areEqual(a*raw[i], moved[i], 1e-14) or !areEqual(moved[i], pooled[i], 1e-15) or !areEqual(moved[i], inPlace[i], 1e-15);
+        }
+        if(failed){
+            numErrors++;
+            std::cout << "Points::transform failed \n";
+        }
+    }
+    // Rotation about the centroid, far from the origin: the error is a few ulps of the coordinates
+    {
+        const double far = 1e8;
+        std::vector<std::array<double,3>> raw;
+        for(int i = 0; i < 100; ++i){
+            raw.push_back({far + std::cos(0.1*i), far + std::sin(0.3*i), far + 0.01*i});
+        }
+        const Points<double> cloud(raw);
+        const std::array<double,3> pivot = cloud.centroid();
+        Points<double> turned;
+        cloud.rotateAbout(r1.convertToMatrix(), pivot, {0., 0., 1.}, turned);
+        double error = 0;
+        for(std::size_t i = 0; i < raw.size(); ++i){
+            const std::array<double,3> centered{raw[i][0] - pivot[0], raw[i][1] - pivot[1], raw[i][2] - pivot[2]};
+            const std::array<double,3> expected = r1*centered;
+            for(int c = 0; c < 3; ++c){
+                error = std::max(error, std::abs(turned[i][c] - (c == 2 ? 1. : 0.) - pivot[c] - expected[c]));
+            }
+        }
+        const std::array<double,3> mean = Points<double>().centroid();
+        if(error > 1e-7 or std::abs(pivot[0] - far) > 1 or mean[0] != 0 or Points<float>(std::vector<std::array<float,3>>(1000, {0.1f, 0.2f, 0.3f})).centroid()[0] != 0.1f){
+            numErrors++;
+            std::cout << "Points::rotateAbout or centroid failed: " << error << " \n";
+        }
+    }
+}
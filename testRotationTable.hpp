@@ -0,0 +1,105 @@
+#pragma once
+#include <iostream>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "quaternion.hpp"
+#include "matrix.hpp"
+#include "axisAngle.hpp"
+#include "points.hpp"
+#include "parallel.hpp"
+#include "rotationTable.hpp"
+#include "test.hpp"
+
+// Index of the entry of table equal to M, or -1
+template<typename T>
+int findEntry(const RotationTable<T> &table, const Matrix3<T> &M, double precision) {
+    for(std::size_t k = 0; k < table.size(); ++k){
+        if(areEqual(table.matrix(k).matrix(), M, precision)){
+            return static_cast<int>(k);
+        }
+    }
+    return -1;
+}
+
+void TestRotationTable(){
+    int numErrors = 0;
+    // The cube symmetries: 24 distinct rotations, the identity first, closed under composition, quaternions matching the matrices
+    {
+        const RotationTable<double> cube = RotationTable<double>::cubeSymmetries();
+        bool failed = cube.size() != 24 or !areEqual(cube.matrix(0).matrix(), Matrix3<double>({1., 0., 0., 0., 1., 0., 0., 0., 1.}), 1e-15);
+        for(std::size_t a = 0; a < cube.size() and !failed; ++a){
+            const Matrix3<double> A = cube.matrix(a).matrix();
+            failed = failed or findEntry(cube, A, 1e-15) != static_cast<int>(a) or std::abs(A.determinant() - 1.) > 0
+                     or !areEqual(cube.quaternion(a).convertToMatrix().value(), A, 1e-15);
+            for(std::size_t b = 0; b < cube.size(); ++b){
+                failed = failed or findEntry(cube, Matrix3<double>(A*cube.matrix(b).matrix()), 1e-15) < 0;
+            }
+        }
+        if(failed){
+            numErrors++;
+            std::cout << "RotationTable::cubeSymmetries failed \n";
+        }
+    }
+    // Yaw bins: entry k is the rotation by 2 pi k / bins, and bin() finds the nearest one, wrapping around
+    {
+        const std::size_t bins = 36;
+        constexpr double pi = 3.14159265358979323846;
+        const auto yaw = RotationTable<double>::aboutAxis({0., 0., 2.}, bins);
+        bool failed = !yaw or yaw->size() != bins or RotationTable<double>::aboutAxis({0., 0., 0.}, bins)
+                      or RotationTable<double>::aboutAxis({0., 0., 1.}, 0);
+        for(std::size_t k = 1; yaw and k < bins; ++k){
+            const double angle = 2*pi*static_cast<double>(k)/bins;
+            auto expected = axisAngle<double>({0., 0., 1.}, angle).convertToMatrix();
+            failed = failed or !areEqual(*expected, yaw->matrix(k).matrix(), 1e-15)
+                     or RotationTable<double>::bin(angle + 0.4*2*pi/bins, bins) != k
+                     or RotationTable<double>::bin(angle - 0.4*2*pi/bins - 4*pi, bins) != k;
+        }
+        failed = failed or RotationTable<double>::bin(-0.01, bins) != 0 or RotationTable<double>::bin(2*pi - 0.01, bins) != 0
+                 or RotationTable<float>::bin(7.f, bins) != RotationTable<double>::bin(7., bins);
+        if(failed){
+            numErrors++;
+            std::cout << "RotationTable::aboutAxis failed \n";
+        }
+    }
+    // Entries are cache line aligned
+    {
+        const RotationTable<float> cube = RotationTable<float>::cubeSymmetries();
+        const auto yaw = RotationTable<double>::aboutAxis({1., 0., 0.}, 5);
+        if(reinterpret_cast<std::uintptr_t>(&cube[0]) % 64 != 0 or reinterpret_cast<std::uintptr_t>(&(*yaw)[3]) % 64 != 0){
+            numErrors++;
+            std::cout << "RotationTable entries are not cache line aligned \n";
+        }
+    }
+    // Gather apply: every point by its own entry, same as point by point, in place and on a pool too; bad indices are rejected
+    {
+        RotationTable<double> table = RotationTable<double>::cubeSymmetries();
+        const std::uint32_t tilted = table.add(UnitQuaternion<double>::fromQuaternion({0.9, 0.1, -0.3, 0.2}).value());
+        const std::vector<std::array<double,3>> raw = oddSizedCloud();
+        std::vector<std::uint32_t> index;
+        for(std::size_t i = 0; i < raw.size(); ++i){
+            index.push_back(static_cast<std::uint32_t>((i*7) % table.size()));
+        }
+        const Points<double> cloud(raw);
+        Points<double> rotated, pooled, inPlace = cloud;
+        ThreadPool pool(4);
+        bool failed = !table.apply(cloud, index, rotated) or !table.apply(cloud, index, pooled, {&pool, 100})
+                      or !table.apply(inPlace, index, inPlace) or rotated.size() != raw.size();
+        for(std::size_t i = 0; !failed and i < raw.size(); ++i){
+            auto expected = table.quaternion(index[i])*raw[i];
+            failed = !areEqual(expected, rotated[i], 1e-13) or !areEqual(rotated[i], pooled[i], 1e-13) or !areEqual(rotated[i], inPlace[i], 1e-13)
+                     or !areEqual(table.apply(index[i], raw[i]), rotated[i], 1e-13);
+        }
+        Points<double> untouched = cloud;
+        index.back() = tilted + 1;
+        failed = failed or table.apply(cloud, index, untouched) or !areEqual(untouched[0], raw[0], 1e-15);
+        index.pop_back();
+        failed = failed or table.apply(cloud, index, untouched);
+        Points<double> none;
+        failed = failed or !table.apply(Points<double>(), {}, none) or none.size() != 0;
+        if(failed){
+            numErrors++;
+            std::cout << "RotationTable::apply failed \n";
+        }
+    }
+}
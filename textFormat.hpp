@@ -0,0 +1,200 @@
+#pragma once
+#include <array>
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <charconv>
+#include <limits>
+#include <system_error>
+
+//Text point format (as in ellipse.dat): three whitespace separated numbers per point.
+//Reading and writing go through large blocks and std::from_chars / std::to_chars, with no per-number
+//stream overhead. Written numbers are the shortest strings that read back to the same value.
+namespace detail
+{
+	inline bool isSpace(char c) {
+		return c == ' ' or c == '\n' or c == '\t' or c == '\r' or c == '\v' or c == '\f';
+	}
+
+	//Parse one number starting at first (no leading whitespace). Returns the end of the number, or nullptr.
+	template<typename T>
+	const char* parseNumber(const char *first, const char *last, T &value) {
+		if(first != last and *first == '+'){ //accepted by operator>>, not by from_chars
+			++first;
+		}
+#if defined(__cpp_lib_to_chars)
+		auto result = std::from_chars(first, last, value);
+		return result.ec == std::errc() ? result.ptr : nullptr;
+#else
+		//fallback for standard libraries without floating-point from_chars. strtold needs a null-terminated
+		//string: copy only up to the next whitespace, not the rest of the block (that would be O(n^2) per block)
+		const char *tokenEnd = first;
+		while(tokenEnd != last and !isSpace(*tokenEnd)){
+			++tokenEnd;
+		}
+		std::string token(first, tokenEnd);
+		char *end = nullptr;
+		long double parsed = std::strtold(token.c_str(), &end);
+		if(end == token.c_str()){
+			return nullptr;
+		}
+		value = static_cast<T>(parsed);
+		return first + (end - token.c_str());
+#endif
+	}
+
+	template<typename T>
+	char* formatNumber(char *first, char *last, T value) {
+#if defined(__cpp_lib_to_chars)
+		return std::to_chars(first, last, value).ptr;
+#else
+		int written = std::snprintf(first, static_cast<std::size_t>(last - first), "%.*Lg",
+		                            std::numeric_limits<T>::max_digits10, static_cast<long double>(value));
+		return first + written;
+#endif
+	}
+}
+
+class TextPointReader{
+	private:
+	std::ifstream input;
+	std::vector<char> buffer;
+	std::size_t begin = 0; //first unparsed byte
+	std::size_t end = 0; //end of the valid bytes
+	bool atEnd = false; //nothing left in the file
+	bool failed = false; //a token that is not a number: stop, like operator>>
+
+	//Move the unparsed tail to the front and read more. Returns false if nothing new was read.
+	bool refill() {
+		if(atEnd){
+			return false;
+		}
+		std::size_t rest = end - begin;
+		if(rest == buffer.size()){ //a single token longer than the buffer
+			buffer.resize(2*buffer.size());
+		}
+		std::copy(buffer.begin() + begin, buffer.begin() + end, buffer.begin());
+		begin = 0;
+		end = rest;
+		input.read(buffer.data() + end, static_cast<std::streamsize>(buffer.size() - end));
+		std::size_t got = static_cast<std::size_t>(input.gcount());
+		end += got;
+		if(!input){
+			atEnd = true;
+		}
+		return got > 0;
+	}
+
+	//End of the complete tokens in the buffer: a token touching the buffer end may continue in the next block
+	std::size_t completeEnd() const {
+		if(atEnd){
+			return end;
+		}
+		std::size_t last = end;
+		while(last > begin and !detail::isSpace(buffer[last - 1])){
+			--last;
+		}
+		return last;
+	}
+
+	public:
+	explicit TextPointReader(const std::string &filename, std::size_t blockSize = 1 << 20)
+		: input(filename, std::ios::binary), buffer(std::max<std::size_t>(blockSize, 64)) {}
+
+	bool isOpen() const {
+		return input.is_open();
+	}
+
+	//Read up to n points into the coordinate arrays. Returns the number read; fewer than n only at the end of the data.
+	template<typename T>
+	std::size_t read(T *x, T *y, T *z, std::size_t n) {
+		std::size_t count = 0;
+		while(count < n and !failed){
+			std::size_t limit = completeEnd();
+			const char *p = buffer.data() + begin;
+			const char *stop = buffer.data() + limit;
+			while(count < n){
+				T coordinates[3];
+				const char *q = p;
+				int c = 0;
+				for(; c < 3; ++c){
+					while(q != stop and detail::isSpace(*q)){
+						++q;
+					}
+					if(q == stop){
+						break;
+					}
+					q = detail::parseNumber(q, stop, coordinates[c]);
+					if(!q){
+						failed = true;
+						break;
+					}
+				}
+				if(c < 3){ //point incomplete in this block (or invalid)
+					break;
+				}
+				x[count] = coordinates[0];
+				y[count] = coordinates[1];
+				z[count] = coordinates[2];
+				++count;
+				p = q;
+			}
+			begin = static_cast<std::size_t>(p - buffer.data());
+			if(count < n and !failed and !refill()){
+				break;
+			}
+		}
+		return count;
+	}
+};
+
+class TextPointWriter{
+	private:
+	std::ofstream output;
+	std::vector<char> buffer;
+	std::size_t used = 0;
+	static constexpr std::size_t maxLine = 3*64 + 3; //three numbers, two spaces and a newline
+
+	public:
+	explicit TextPointWriter(const std::string &filename, std::size_t blockSize = 1 << 20)
+		: output(filename, std::ios::binary), buffer(std::max(blockSize, 2*maxLine)) {}
+	TextPointWriter( TextPointWriter const& ) = delete;
+	TextPointWriter& operator=(TextPointWriter const&) = delete;
+	~TextPointWriter() {
+		flush();
+	}
+
+	bool isOpen() const {
+		return output.is_open();
+	}
+
+	template<typename T>
+	void write(const T *x, const T *y, const T *z, std::size_t n) {
+		for(std::size_t i = 0; i < n; ++i){
+			if(buffer.size() - used < maxLine){
+				flush();
+			}
+			char *p = buffer.data() + used;
+			char *last = buffer.data() + buffer.size();
+			p = detail::formatNumber(p, last, x[i]);
+			*p++ = ' ';
+			p = detail::formatNumber(p, last, y[i]);
+			*p++ = ' ';
+			p = detail::formatNumber(p, last, z[i]);
+			*p++ = '\n';
+			used = static_cast<std::size_t>(p - buffer.data());
+		}
+	}
+
+	//Returns false if writing failed
+	bool flush() {
+		output.write(buffer.data(), static_cast<std::streamsize>(used));
+		used = 0;
+		output.flush();
+		return static_cast<bool>(output);
+	}
+};